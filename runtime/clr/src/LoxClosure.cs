@@ -15,31 +15,26 @@ namespace Lox;
 /// matching ObjFunction::arity.
 /// </summary>
 public abstract class LoxClosure : ILoxCallable {
-    // vm.cpp's own CallFrame ceiling (src/vm.h FRAMES_MAX). Generated CIL
-    // recurses the real CLR call stack one frame per Lox call - unlike
-    // vm.cpp's fixed CallFrame array, nothing here bounds that on its own,
-    // and the real stack tolerates far more than 256 nested calls before
-    // it would fault. Counting here keeps every recursion depth that
+    // vm.cpp's own CallFrame ceiling (src/vm.h kDefaultMaxFrames, the
+    // default of `loxpp --max-stack`). Generated CIL recurses the real CLR
+    // call stack one frame per Lox call - unlike vm.cpp's CallFrame array,
+    // nothing here bounds that on its own. Counting here keeps every recursion depth that
     // native accepts or rejects agreeing on the CLR backend too, with the
     // same message, instead of only diverging once a real stack fault (an
     // uncatchable StackOverflowException) hits some larger, host-dependent
     // depth.
     //
-    // Native actually has TWO ceilings, not one: src/vm.h's STACK_MAX
-    // (2048 value-stack slots, shared by every live frame) can be reached
-    // first by a frame with many locals, well below 256 frames deep -
-    // src/vm.cpp guards no push against it, so that path is a native
-    // buffer overflow with no defined result to match. This counter
-    // reproduces only the frame ceiling; the value-stack one is a native
-    // defect (tracked separately), not a gap in this class.
-    private const int FramesMax = 256;
+    // Native's value stack grows with the frame array (VM::call reserves
+    // each function's maximum stack height on entry), so the frame count
+    // is its only ceiling.
+    private const int FramesMax = 10000;
 
     // Starts at 1, not 0: src/vm.cpp's own interpret() pushes the
     // top-level script itself as CallFrame 0 through the very same call()
     // this class's CallAsSelf mirrors, before the script body ever runs,
     // and that frame is never popped until the whole program ends. A
     // counter starting at 0 here would let one more nested Lox call
-    // succeed than FRAMES_MAX allows natively.
+    // succeed than native allows.
     private static int s_frameCount = 1;
 
     public readonly string Name; // null for the top-level script, per <script>
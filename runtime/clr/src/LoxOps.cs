@@ -128,6 +128,9 @@ public static class LoxOps {
         if (a is LoxFileMethod fa && b is LoxFileMethod fb) {
             return fa.Name == fb.Name;
         }
+        if (a is LoxStringBuilderMethod xa && b is LoxStringBuilderMethod xb) {
+            return xa.Name == xb.Name;
+        }
         return ReferenceEquals(a, b); // nil (null == null) and every identity-equality object type
     }
 
@@ -399,6 +402,13 @@ public static class LoxOps {
             }
             return m;
         }
+        if (obj is LoxStringBuilder builder) {
+            ILoxCallable m = builder.GetMethod(name);
+            if (m == null) {
+                throw new LoxError($"Undefined property '{name}' on string builder.");
+            }
+            return m;
+        }
         if (obj is not LoxInstance instance) {
             throw new LoxError("Only instances have properties.");
         }
@@ -505,6 +515,9 @@ public static class LoxOps {
         if (receiver is LoxMap map) {
             return InvokeMapMethod(map, name, args);
         }
+        if (receiver is LoxStringBuilder builder) {
+            return InvokeStringBuilderMethod(builder, name, args);
+        }
         throw new LoxError("Only instances, files, and maps have methods.");
     }
 
@@ -621,6 +634,20 @@ public static class LoxOps {
         }
     }
 
+    /// <summary>Same no-allocation dispatch as <see cref="InvokeMapMethod"/>, for StringBuilder.</summary>
+    private static object InvokeStringBuilderMethod(LoxStringBuilder builder, string name, object[] args) {
+        switch (name) {
+        case "append":
+            RequireArity(args, 1, "append");
+            return builder.Append(args[0]);
+        case "build":
+            RequireArity(args, 0, "build");
+            return builder.Build();
+        default:
+            throw new LoxError($"Undefined method '{name}' on string builder.");
+        }
+    }
+
     private static void RequireArity(object[] args, int arity, string method) {
         if (args.Length != arity) {
             throw new LoxError($"'{method}' expects {arity} argument(s) but got {args.Length}.");
@@ -680,7 +707,8 @@ public static class LoxOps {
         // there), and stringifyObj gives every ObjType::NATIVE the same
         // text - so a map or file method value prints identically to any
         // other native function.
-        if (v is LoxNative || v is LoxMapMethod || v is LoxFileMethod) {
+        if (v is LoxNative || v is LoxMapMethod || v is LoxFileMethod ||
+            v is LoxStringBuilderMethod) {
             return "<native fn>";
         }
         if (v is LoxBoundMethod bound) {
@@ -695,6 +723,9 @@ public static class LoxOps {
         if (v is LoxFile) {
             return "<file>";
         }
+        if (v is LoxStringBuilder) {
+            return "<string builder>";
+        }
         if (v is LoxIterator) {
             return "<iterator>";
         }
@@ -131,6 +131,7 @@ public static class LoxRuntime {
             }
             return LoxFile.Open(path, mode);
         }));
+        globals.Define("StringBuilder", new LoxNative("StringBuilder", 0, args => new LoxStringBuilder()));
         RegisterOsAccess(globals);
     }
 
@@ -0,0 +1,63 @@
+using System.Collections.Generic;
+using System.Text;
+
+namespace Lox;
+
+/// <summary>
+/// Mirrors src/stdlib/string_builder_api.cpp's ObjStringBuilder: a mutable
+/// text buffer that <c>append</c> grows in place and <c>build</c> copies out
+/// as a string.
+/// </summary>
+public sealed class LoxStringBuilder {
+    private readonly StringBuilder m_buffer = new();
+
+    // Per-instance cache, as in LoxFile; cross-instance identity comes from
+    // LoxStringBuilderMethod's name-based equality (see LoxOps.Equal).
+    private readonly Dictionary<string, ILoxCallable> m_methodCache = new();
+
+    /// <summary>Appends the str() form of <paramref name="v"/> and returns this builder.</summary>
+    public LoxStringBuilder Append(object v) {
+        m_buffer.Append(v as string ?? LoxOps.Stringify(v));
+        return this;
+    }
+
+    public string Build() => m_buffer.ToString();
+
+    public ILoxCallable GetMethod(string name) {
+        if (m_methodCache.TryGetValue(name, out ILoxCallable cached)) {
+            return cached;
+        }
+        ILoxCallable created = CreateMethod(name);
+        if (created != null) {
+            m_methodCache[name] = created;
+        }
+        return created;
+    }
+
+    private ILoxCallable CreateMethod(string name) {
+        switch (name) {
+        case "append":
+            return new LoxStringBuilderMethod("append", 1, a => Append(a[0]));
+        case "build":
+            return new LoxStringBuilderMethod("build", 0, a => Build());
+        default:
+            return null;
+        }
+    }
+}
+
+/// <summary>
+/// A string builder's native method read as a value, e.g. <c>sb.append</c>.
+/// Carries its name for LoxOps.Equal for the same reason as LoxFileMethod.
+/// </summary>
+internal sealed class LoxStringBuilderMethod : ILoxCallable {
+    public readonly string Name;
+    private readonly LoxNative m_native;
+
+    public LoxStringBuilderMethod(string name, int arity, LoxNative.Fn fn) {
+        Name = name;
+        m_native = new LoxNative(name, arity, fn);
+    }
+
+    public object Call(object[] args) => m_native.Call(args);
+}
@@ -4,16 +4,12 @@ namespace LoxRuntimeTests;
 
 /// <summary>
 /// LoxClosure.CallAsSelf's own call-depth ceiling, mirroring src/vm.h's
-/// FRAMES_MAX (256) and src/vm.cpp's "Stack overflow." error. The boundary
-/// below (254 succeeds, 255 throws) matches native exactly, because
-/// src/vm.cpp's own top-level script call already occupies one of the 256
-/// CallFrame slots before any user call runs - verified against the
-/// release-preset native binary (build/loxpp) on the same recursive
-/// program. This covers only the frame ceiling: native also has a
-/// separate, unguarded value-stack ceiling (src/vm.h STACK_MAX) that a
-/// frame with many locals can reach first, well below depth 256 - that
-/// path is a native buffer overflow with no defined result to match, and
-/// is tracked as a native defect, not exercised here.
+/// kDefaultMaxFrames (10000) and src/vm.cpp's "Stack overflow." error. The
+/// boundary below (9998 succeeds, 9999 throws) matches native exactly,
+/// because src/vm.cpp's own top-level script call already occupies one of
+/// the 10000 CallFrame slots before any user call runs - verified against
+/// the release-preset native binary (build/loxpp) on the same recursive
+/// program.
 /// </summary>
 public static class StackDepthTest {
     public static int Run() {
@@ -28,10 +24,10 @@ public static class StackDepthTest {
             return down.Call(new object[] { n - 1 });
         });
 
-        t.CheckEquals(0.0, down.Call(new object[] { 254.0 }),
-            "254 nested Lox calls succeed, the deepest native's own frame ceiling allows");
-        t.CheckThrows(() => down.Call(new object[] { 255.0 }), typeof(LoxError),
-            "255 nested Lox calls overflow, the same depth src/vm.cpp's FRAMES_MAX rejects");
+        t.CheckEquals(0.0, down.Call(new object[] { 9998.0 }),
+            "down(9998) succeeds, the deepest native's own frame ceiling allows");
+        t.CheckThrows(() => down.Call(new object[] { 9999.0 }), typeof(LoxError),
+            "down(9999) overflows, the same depth src/vm.cpp's kDefaultMaxFrames rejects");
 
         return t.Finish("StackDepthTest");
     }
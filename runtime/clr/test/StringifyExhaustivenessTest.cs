@@ -43,6 +43,7 @@ public static class StringifyExhaustivenessTest {
             [typeof(LoxEnumCtor)] = new LoxEnumCtor(0, 0, "Ctor", "Enum"),
             [typeof(LoxMapMethod)] = LoxOps.GetProperty(SampleMap(), "has"),
             [typeof(LoxFileMethod)] = LoxOps.GetProperty(SampleFile(), "write"),
+            [typeof(LoxStringBuilderMethod)] = LoxOps.GetProperty(new LoxStringBuilder(), "append"),
         };
     }
 
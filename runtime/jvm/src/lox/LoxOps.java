@@ -391,6 +391,13 @@ public final class LoxOps {
             }
             return m;
         }
+        if (obj instanceof LoxStringBuilder) {
+            LoxCallable m = ((LoxStringBuilder) obj).getMethod(name);
+            if (m == null) {
+                throw new LoxError("Undefined property '" + name + "' on string builder.");
+            }
+            return m;
+        }
         if (!(obj instanceof LoxInstance)) {
             throw new LoxError("Only instances have properties.");
         }
@@ -499,6 +506,9 @@ public final class LoxOps {
         if (receiver instanceof LoxMap) {
             return invokeMapMethod((LoxMap) receiver, name, args);
         }
+        if (receiver instanceof LoxStringBuilder) {
+            return invokeStringBuilderMethod((LoxStringBuilder) receiver, name, args);
+        }
         throw new LoxError("Only instances, files, and maps have methods.");
     }
 
@@ -613,6 +623,20 @@ public final class LoxOps {
         }
     }
 
+    /** Same no-allocation dispatch as {@link #invokeMapMethod}, for StringBuilder. */
+    private static Object invokeStringBuilderMethod(LoxStringBuilder builder, String name, Object[] args) {
+        switch (name) {
+        case "append":
+            requireArity(args, 1, "append");
+            return builder.append(args[0]);
+        case "build":
+            requireArity(args, 0, "build");
+            return builder.build();
+        default:
+            throw new LoxError("Undefined method '" + name + "' on string builder.");
+        }
+    }
+
     private static void requireArity(Object[] args, int arity, String method) {
         if (args.length != arity) {
             throw new LoxError(
@@ -684,6 +708,9 @@ public final class LoxOps {
         if (v instanceof LoxFile) {
             return "<file>";
         }
+        if (v instanceof LoxStringBuilder) {
+            return "<string builder>";
+        }
         if (v instanceof LoxIterator) {
             return "<iterator>";
         }
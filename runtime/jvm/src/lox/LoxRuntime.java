@@ -134,6 +134,7 @@ public final class LoxRuntime {
             }
             return LoxFile.open((String) args[0], (String) args[1]);
         }));
+        globals.define("StringBuilder", new LoxNative("StringBuilder", 0, args -> new LoxStringBuilder()));
         registerOsAccess(globals);
     }
 
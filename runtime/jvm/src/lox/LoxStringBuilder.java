@@ -0,0 +1,49 @@
+package lox;
+
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Mirrors src/stdlib/string_builder_api.cpp's ObjStringBuilder: a mutable
+ * text buffer that append() grows in place and build() copies out as a
+ * String.
+ */
+public final class LoxStringBuilder {
+    private final StringBuilder buffer = new StringBuilder();
+
+    // Per-instance cache, as in LoxFile: `sb.append == sb.append` must hold.
+    private final Map<String, LoxCallable> methodCache = new HashMap<>();
+
+    /** Appends the str() form of {@code v} and returns this builder. */
+    public LoxStringBuilder append(Object v) {
+        buffer.append(v instanceof String ? (String) v : LoxOps.stringify(v));
+        return this;
+    }
+
+    public String build() {
+        return buffer.toString();
+    }
+
+    public LoxCallable getMethod(String name) {
+        LoxCallable cached = methodCache.get(name);
+        if (cached != null) {
+            return cached;
+        }
+        LoxCallable created = createMethod(name);
+        if (created != null) {
+            methodCache.put(name, created);
+        }
+        return created;
+    }
+
+    private LoxCallable createMethod(String name) {
+        switch (name) {
+        case "append":
+            return new LoxNative("append", 1, a -> append(a[0]));
+        case "build":
+            return new LoxNative("build", 0, a -> build());
+        default:
+            return null;
+        }
+    }
+}
@@ -107,6 +107,27 @@ int frameHeightEffect(const DecodedInstruction& ins) {
     case Op::RETURN:
     case Op::MATCH_ERROR:
         return 0;
+
+    // Superinstructions and quickened ops: decodeChunk hands out their
+    // canonical op instead.
+    case Op::ADD_LOCALS:
+    case Op::LESS_LOCAL_CONST_JUMP:
+    case Op::INCR_LOCAL:
+    case Op::JUMP_IF_FALSE_POP:
+    case Op::FOR_ITER:
+    case Op::ADD_NUM:
+    case Op::ADD_STR:
+    case Op::SUBTRACT_NUM:
+    case Op::MULTIPLY_NUM:
+    case Op::DIVIDE_NUM:
+    case Op::LESS_NUM:
+    case Op::GREATER_NUM:
+    case Op::INVOKE_LIST_APPEND:
+    case Op::INVOKE_LIST_POP:
+    case Op::GET_UPVALUE_FLAT:
+    case Op::TAIL_CALL:
+    case Op::TAIL_INVOKE:
+        break;
     }
     throw std::runtime_error(
         "capture_analysis: no frame-height effect for opcode " +
@@ -22,7 +22,10 @@ std::string functionDisplayName(ObjFunction* fn) {
 DecodedInstruction decodeOne(const Chunk& chunk, int offset) {
     DecodedInstruction ins;
     ins.offset = offset;
-    ins.op = toOpcode(chunk.at(offset));
+    // A superinstruction head decodes as the instruction it overlays; the
+    // rest of its run follows at the original offsets (chunk.h), so the
+    // backends always see the compiler's canonical stream.
+    ins.op = canonicalOp(toOpcode(chunk.at(offset)));
 
     switch (ins.op) {
     // No operand.
@@ -122,7 +125,7 @@ DecodedInstruction decodeOne(const Chunk& chunk, int offset) {
         ObjFunction* target = asObjFunction(fnVal);
         int cursor = offset + 3;
         for (int i = 0; i < target->upvalueCount; i++) {
-            bool isLocal = chunk.at(cursor) != 0;
+            bool isLocal = (chunk.at(cursor) & kUpvalueLocal) != 0;
             uint8_t index = chunk.at(cursor + 1);
             ins.upvalues.push_back({isLocal, index});
             cursor += 2;
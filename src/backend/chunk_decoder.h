@@ -19,7 +19,8 @@ struct ObjFunction;
 // One captured upvalue named by a CLOSURE operand. `isLocal` selects whether
 // `index` names a slot in the enclosing function (true) or an upvalue slot
 // the enclosing function already captured (false) — see vm.cpp's CLOSURE
-// handler.
+// handler. The kUpvalueFlat bit only appears in the VM's own compile, so it is
+// not decoded.
 struct ClosureUpvalue {
     bool isLocal;
     uint8_t index;
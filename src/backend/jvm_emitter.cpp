@@ -134,6 +134,40 @@ std::string opName(Op op) {
         return "INSTANCEOF";
     case Op::IS_SEQ:
         return "IS_SEQ";
+    case Op::ADD_LOCALS:
+        return "ADD_LOCALS";
+    case Op::LESS_LOCAL_CONST_JUMP:
+        return "LESS_LOCAL_CONST_JUMP";
+    case Op::INCR_LOCAL:
+        return "INCR_LOCAL";
+    case Op::JUMP_IF_FALSE_POP:
+        return "JUMP_IF_FALSE_POP";
+    case Op::FOR_ITER:
+        return "FOR_ITER";
+    case Op::ADD_NUM:
+        return "ADD_NUM";
+    case Op::ADD_STR:
+        return "ADD_STR";
+    case Op::SUBTRACT_NUM:
+        return "SUBTRACT_NUM";
+    case Op::MULTIPLY_NUM:
+        return "MULTIPLY_NUM";
+    case Op::DIVIDE_NUM:
+        return "DIVIDE_NUM";
+    case Op::LESS_NUM:
+        return "LESS_NUM";
+    case Op::GREATER_NUM:
+        return "GREATER_NUM";
+    case Op::INVOKE_LIST_APPEND:
+        return "INVOKE_LIST_APPEND";
+    case Op::INVOKE_LIST_POP:
+        return "INVOKE_LIST_POP";
+    case Op::GET_UPVALUE_FLAT:
+        return "GET_UPVALUE_FLAT";
+    case Op::TAIL_CALL:
+        return "TAIL_CALL";
+    case Op::TAIL_INVOKE:
+        return "TAIL_INVOKE";
     }
     return "UNKNOWN_OP";
 }
@@ -2002,6 +2036,27 @@ std::optional<int> nativePops(Op op, const DecodedInstruction& in) {
     case Op::LOOP:
     case Op::JUMP_TABLE:
         return std::nullopt;
+
+    // Superinstructions and quickened ops: decodeChunk hands out their
+    // canonical op instead.
+    case Op::ADD_LOCALS:
+    case Op::LESS_LOCAL_CONST_JUMP:
+    case Op::INCR_LOCAL:
+    case Op::JUMP_IF_FALSE_POP:
+    case Op::FOR_ITER:
+    case Op::ADD_NUM:
+    case Op::ADD_STR:
+    case Op::SUBTRACT_NUM:
+    case Op::MULTIPLY_NUM:
+    case Op::DIVIDE_NUM:
+    case Op::LESS_NUM:
+    case Op::GREATER_NUM:
+    case Op::INVOKE_LIST_APPEND:
+    case Op::INVOKE_LIST_POP:
+    case Op::GET_UPVALUE_FLAT:
+    case Op::TAIL_CALL:
+    case Op::TAIL_INVOKE:
+        break;
     }
     // No `default:` above on purpose (this function's own note) — reachable
     // only if `-Wswitch` was ignored, which is itself the bug to fix.
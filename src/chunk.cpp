@@ -35,4 +35,21 @@ int Chunk::getLine(int offset) const {
     return 0; // Error case
 }
 
+bool Chunk::addInlineCache(int offset) {
+    if (m_inlineCaches.size() > UINT16_MAX) {
+        return false;
+    }
+    m_inlineCacheIndex.resize(size(), 0);
+    m_inlineCacheIndex[offset] = static_cast<uint16_t>(m_inlineCaches.size());
+    m_inlineCaches.emplace_back();
+    return true;
+}
+
+void Chunk::setGlobalSlot(uint16_t constant, uint16_t slot) {
+    if (m_globalSlots.size() <= constant) {
+        m_globalSlots.resize(constant + 1, 0);
+    }
+    m_globalSlots[constant] = slot;
+}
+
 Value Chunk::getConstant(uint16_t idx) const { return m_constants.at(idx); }
@@ -2,6 +2,7 @@
 
 #include "value.h"
 
+#include <array>
 #include <cstdint>
 #include <optional>
 #include <vector>
@@ -9,6 +10,9 @@
 
 using Byte = uint8_t;
 
+struct ObjClass;
+struct Shape;
+
 // clang-format off
 enum class Op : Byte {
     CONSTANT,
@@ -68,11 +72,134 @@ enum class Op : Byte {
     INSTANCEOF,  // 2-byte constant (class name ObjString*); pop value, push
                  // bool
     IS_SEQ, // no operands — pop value, push true if it is a sequence type
+
+    // Superinstructions (peephole.cpp). Never emitted by the compiler: the
+    // peephole pass overwrites the *first* opcode byte of a matching run and
+    // leaves the rest of the run in place, so offsets, jump targets and the
+    // line table are unchanged, and a guard miss can simply execute the run
+    // unfused. canonicalOp() maps each one back to the op it overlays.
+    ADD_LOCALS,            // GET_LOCAL a, GET_LOCAL b, ADD
+    LESS_LOCAL_CONST_JUMP, // GET_LOCAL a, CONSTANT k, LESS, JUMP_IF_FALSE, POP
+    INCR_LOCAL,            // GET_LOCAL a, CONSTANT k, ADD, SET_LOCAL b, POP
+    JUMP_IF_FALSE_POP,     // JUMP_IF_FALSE, POP
+    // A for-in loop header (compiler.cpp forInStatement):
+    //   GET_LOCAL it, ITER_HAS_NEXT, JUMP_IF_FALSE, POP,
+    //   GET_LOCAL it, ITER_NEXT, SET_LOCAL item, POP
+    FOR_ITER,
+
+    // Quickened forms (VM::run). Never emitted by the compiler either: the
+    // generic op rewrites its own byte to one of these once it has seen the
+    // operand types, and the quickened op rewrites itself back (deoptimizes)
+    // when a guard fails. Same length and stack effect as the generic op.
+    ADD_NUM,      // ADD on two Numbers
+    ADD_STR,      // ADD on two strings (concatenation)
+    SUBTRACT_NUM, // SUBTRACT on two Numbers
+    MULTIPLY_NUM, // MULTIPLY on two Numbers
+    DIVIDE_NUM,   // DIVIDE on two Numbers
+    LESS_NUM,     // LESS on two Numbers
+    GREATER_NUM,  // GREATER on two Numbers
+    INVOKE_LIST_APPEND, // INVOKE of list.append(x)
+    INVOKE_LIST_POP,    // INVOKE of list.pop()
+
+    // Flattened capture (compiler.cpp resolveUpvalue). Emitted only by the
+    // VM's compile, in place of GET_UPVALUE, for a variable the compiler
+    // proved is never reassigned: the closure holds a copy of its value
+    // instead of an ObjUpvalue. The matching CLOSURE descriptor carries
+    // kUpvalueFlat.
+    GET_UPVALUE_FLAT, // 1-byte upvalue slot
+
+    // Tail calls (peephole.cpp). Overlaid like a superinstruction on the head
+    // of a CALL or INVOKE that is directly followed by RETURN; the RETURN
+    // stays live for the callees the VM does not call in place.
+    TAIL_CALL,   // CALL argc, RETURN
+    TAIL_INVOKE, // INVOKE name argc, RETURN
 };
 // clang-format on
 
+// Number of opcodes; keep in sync with the last enumerator above.
+inline constexpr int OP_COUNT = static_cast<int>(Op::TAIL_INVOKE) + 1;
+
+// Bits of the first byte of each CLOSURE upvalue descriptor: kUpvalueLocal
+// means the index names a local slot of the enclosing function rather than
+// one of its upvalues; kUpvalueFlat means the value is copied into the
+// closure (see GET_UPVALUE_FLAT).
+inline constexpr Byte kUpvalueLocal = 0x01;
+inline constexpr Byte kUpvalueFlat = 0x02;
+
+// The instruction a superinstruction's head byte, a quickened op, a
+// flattened capture read or a tail call stands in for. Everything outside the
+// VM's dispatch loop (disassembly aside) reads a fused or quickened chunk
+// through this, so it sees exactly the bytecode the compiler emits for the
+// backends.
+constexpr Op canonicalOp(Op op) {
+    switch (op) {
+    case Op::ADD_LOCALS:
+    case Op::LESS_LOCAL_CONST_JUMP:
+    case Op::INCR_LOCAL:
+    case Op::FOR_ITER:
+        return Op::GET_LOCAL;
+    case Op::JUMP_IF_FALSE_POP:
+        return Op::JUMP_IF_FALSE;
+    case Op::ADD_NUM:
+    case Op::ADD_STR:
+        return Op::ADD;
+    case Op::SUBTRACT_NUM:
+        return Op::SUBTRACT;
+    case Op::MULTIPLY_NUM:
+        return Op::MULTIPLY;
+    case Op::DIVIDE_NUM:
+        return Op::DIVIDE;
+    case Op::LESS_NUM:
+        return Op::LESS;
+    case Op::GREATER_NUM:
+        return Op::GREATER;
+    case Op::INVOKE_LIST_APPEND:
+    case Op::INVOKE_LIST_POP:
+    case Op::TAIL_INVOKE:
+        return Op::INVOKE;
+    case Op::TAIL_CALL:
+        return Op::CALL;
+    case Op::GET_UPVALUE_FLAT:
+        return Op::GET_UPVALUE;
+    default:
+        return op;
+    }
+}
+
 inline Op toOpcode(Byte byte) { return static_cast<Op>(byte); }
 
+// Polymorphic inline cache for one property site (GET_PROPERTY, INVOKE,
+// SET_PROPERTY). Holds up to kEntries receiver layouts; a site that sees more
+// goes megamorphic: it stops caching and always takes the slow path.
+//
+// GET_PROPERTY/INVOKE entries are keyed by (class, version, shape) and
+// resolve either to a field slot of that shape or, when the shape has no
+// such field, to a method of the class. DEFINE_METHOD and INHERIT bump the
+// class's version, which retires its entries. SET_PROPERTY entries are keyed
+// by shape alone: they store into an existing slot, or add the field by
+// following a cached shape transition.
+struct InlineCache {
+    static constexpr int kEntries = 4;
+
+    struct Entry {
+        ObjClass* klass{nullptr};
+        uint32_t version{0}; // ObjClass::version when the entry was filled
+        int32_t slot{-1};    // field slot, or -1 for a method
+        // Receiver layout; nullptr for dictionary-mode instances and for
+        // file and map receivers, which have no fields.
+        Shape* shape{nullptr};
+        Shape* transition{nullptr}; // SET_PROPERTY adding a field
+        Value method;
+    };
+
+    std::array<Entry, kEntries> entries{};
+    uint8_t count{0};
+    bool megamorphic{false};
+#ifdef LOXPP_PROFILE
+    int profileSlot{-1}; // index into ProfilerData::inlineCaches
+#endif
+};
+
 class Chunk : std::vector<Byte> {
   public:
     using std::vector<Byte>::at;
@@ -90,7 +217,34 @@ class Chunk : std::vector<Byte> {
     [[nodiscard]] const ValueArray& constants() const { return m_constants; }
     [[nodiscard]] int getLine(int offset) const;
 
+    // Inline caches, one per property site. The compiler allocates a site's
+    // cache right after emitting its opcode at `offset`; false means the
+    // chunk has run out of cache slots.
+    bool addInlineCache(int offset);
+    // The cache of the site whose opcode byte is at `site` (a pointer into
+    // data()); the site must have been given one by addInlineCache().
+    InlineCache& inlineCacheAt(const Byte* site) {
+        return m_inlineCaches[m_inlineCacheIndex[site - data()]];
+    }
+    [[nodiscard]] const std::vector<InlineCache>& inlineCaches() const {
+        return m_inlineCaches;
+    }
+
+    // Global-variable slots (see GlobalSlots), indexed by the constant that
+    // names the variable in GET_GLOBAL/SET_GLOBAL/DEFINE_GLOBAL. Only filled
+    // in when the compiler is given a GlobalSlots, i.e. for the VM.
+    void setGlobalSlot(uint16_t constant, uint16_t slot);
+    [[nodiscard]] const uint16_t* globalSlots() const {
+        return m_globalSlots.data();
+    }
+
   private:
     ValueArray m_constants;
     std::vector<std::pair<int, int>> m_lines;
+    std::vector<InlineCache> m_inlineCaches;
+    // Indexed by code offset; only the opcode bytes of cached sites are
+    // meaningful.
+    std::vector<uint16_t> m_inlineCacheIndex;
+    // Indexed by constant; only the names of globals are meaningful.
+    std::vector<uint16_t> m_globalSlots;
 };
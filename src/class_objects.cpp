@@ -0,0 +1,76 @@
+#include "class_objects.h"
+#include "memory_manager.h"
+
+#include <algorithm>
+
+ObjInstance::ObjInstance(ObjClass* k, Shape* root, uint32_t inlineSlots,
+                         VmAllocator<Value> alloc)
+    : Obj(ObjType::INSTANCE), klass(k), shape(root), inlineSlots(inlineSlots),
+      overflow(alloc) {
+    std::uninitialized_fill_n(inlineValues(), inlineSlots, Value{Nil{}});
+}
+
+void* ObjInstance::operator new(std::size_t size, uint32_t inlineSlots) {
+    return ::operator new(size + inlineSlots * sizeof(Value));
+}
+
+void ObjInstance::operator delete(void* p) { ::operator delete(p); }
+
+void ObjInstance::operator delete(void* p, uint32_t /*inlineSlots*/) {
+    ::operator delete(p);
+}
+
+bool ObjInstance::getField(ObjString* name, Value& out) const {
+    if (dictionary) {
+        return dictionary->get(name, out);
+    }
+    int i = shape->slotOf(name);
+    if (i < 0) {
+        return false;
+    }
+    out = slot(static_cast<uint32_t>(i));
+    return true;
+}
+
+void ObjInstance::setField(ObjString* name, Value value, MemoryManager& mm) {
+    if (!dictionary) {
+        int i = shape->slotOf(name);
+        if (i >= 0) {
+            slot(static_cast<uint32_t>(i)) = value;
+            return;
+        }
+        if (shape->slotCount() < kMaxShapeSlots) {
+            addField(mm.shapes().transition(shape, name), value);
+            return;
+        }
+        toDictionary(mm);
+    }
+    dictionary->set(name, value);
+}
+
+void ObjInstance::addField(Shape* next, Value value) {
+    uint32_t i = shape->slotCount();
+    if (i < inlineSlots) {
+        inlineValues()[i] = value;
+    } else {
+        // push_back may collect; `shape` still describes the slots traced.
+        overflow.push_back(value);
+        if (klass->inlineSlotHint <= i) {
+            klass->inlineSlotHint = std::min(i + 1, kMaxInlineSlots);
+        }
+    }
+    shape = next;
+}
+
+// Fills the table while the instance is still traced through its shape, so a
+// collection triggered by the table's growth sees every field.
+void ObjInstance::toDictionary(MemoryManager& mm) {
+    auto table = std::make_unique<Table>(VmAllocator<Entry>{&mm});
+    for (uint32_t i = 0; i < shape->slotCount(); i++) {
+        table->set(shape->keys[i], slot(i));
+    }
+    dictionary = std::move(table);
+    shape = nullptr;
+    overflow.clear();
+    overflow.shrink_to_fit();
+}
@@ -2,14 +2,27 @@
 
 #include "exec_objects.h"
 #include "object.h"
+#include "shape.h"
 #include "table.h"
 #include "value.h"
 #include "vm_allocator.h"
 
+#include <cstddef>
+#include <memory>
+
+class MemoryManager;
+
 struct ObjClass : public Obj {
     ObjString* name;
     ObjClass* superclass{nullptr}; // set by Op::INHERIT
     Table methods;
+    uint32_t version{0}; // bumped whenever `methods` changes; see InlineCache
+    // methods["init"], resolved when the method is defined or inherited so
+    // that constructing an instance needs no lookup. Kept alive by `methods`.
+    ObjClosure* initializer{nullptr};
+    // Inline field slots to give the next instance; grows as instances
+    // outgrow it (see ObjInstance).
+    uint32_t inlineSlotHint{4};
 
     ObjClass(ObjString* n, VmAllocator<Entry> alloc)
         : Obj(ObjType::CLASS), name(n), methods(alloc) {}
@@ -21,12 +34,64 @@ inline bool isClass(const Value& v) {
     return isValueOfType<ObjType::CLASS>(v);
 } // NOLINT
 
+// Fields are laid out by a Shape (shape.h): slot i holds the field named
+// shape->keys[i]. The first `inlineSlots` slots live in a Value array
+// allocated right after the object (sized from the class's inlineSlotHint
+// when the instance is created, so it never moves); later ones spill into
+// `overflow`. Past kMaxShapeSlots fields the instance drops its shape and
+// keeps every field in a Table instead (dictionary mode).
+//
+// Created only through MemoryManager::createInstance().
 struct ObjInstance : public Obj {
+    static constexpr uint32_t kMaxInlineSlots = 16;
+    static constexpr uint32_t kMaxShapeSlots = 32;
+
     ObjClass* klass;
-    Table fields; // ObjString* → Value (arbitrary runtime fields)
+    Shape* shape;         // nullptr in dictionary mode
+    uint32_t inlineSlots; // capacity of the trailing Value array
+    VmVector<Value> overflow;
+    std::unique_ptr<Table> dictionary; // dictionary mode only
+
+    ObjInstance(ObjClass* k, Shape* root, uint32_t inlineSlots,
+                VmAllocator<Value> alloc);
+
+    static void* operator new(std::size_t size, uint32_t inlineSlots);
+    static void operator delete(void* p);
+    static void operator delete(void* p, uint32_t inlineSlots);
+
+    Value* inlineValues() { return reinterpret_cast<Value*>(this + 1); }
+    const Value* inlineValues() const {
+        return reinterpret_cast<const Value*>(this + 1);
+    }
+    // Storage for slot i of the current shape.
+    Value& slot(uint32_t i) {
+        return i < inlineSlots ? inlineValues()[i] : overflow[i - inlineSlots];
+    }
+    [[nodiscard]] const Value& slot(uint32_t i) const {
+        return i < inlineSlots ? inlineValues()[i] : overflow[i - inlineSlots];
+    }
+
+    bool getField(ObjString* name, Value& out) const;
+    // May allocate (overflow growth, dictionary conversion): the instance and
+    // `value` must be reachable by the GC.
+    void setField(ObjString* name, Value value, MemoryManager& mm);
+    // Adds the field that takes this instance from `shape` to `next`, where
+    // next == shapes.transition(shape, key) for some key. May allocate.
+    void addField(Shape* next, Value value);
+
+    template <typename F>
+    void forEachField(F&& f) const {
+        if (dictionary) {
+            dictionary->forEach(f);
+            return;
+        }
+        for (uint32_t i = 0; i < shape->slotCount(); i++) {
+            f(shape->keys[i], slot(i));
+        }
+    }
 
-    ObjInstance(ObjClass* k, VmAllocator<Entry> alloc)
-        : Obj(ObjType::INSTANCE), klass(k), fields(alloc) {}
+  private:
+    void toDictionary(MemoryManager& mm);
 };
 
 inline bool isObjInstance(Obj* o) { return isObjType(o, ObjType::INSTANCE); }
@@ -1,8 +1,10 @@
 #include "compiler.h"
 #include "debug.h"
 #include "escape.h"
+#include "global_slots.h"
 #include "memory_manager.h"
 #include "objects.h"
+#include "peephole.h"
 #include "utility.h"
 
 #include <algorithm>
@@ -13,11 +15,45 @@
 #include <set>
 #include <unistd.h>
 
-ObjFunction* compile(const std::string& source, MemoryManager* mm) {
+// Every name that appears as the target of an assignment `name = ...`
+// anywhere in `source`. A local whose name is not in the set is never written
+// after its initialization, so a closure can capture its value instead of its
+// slot. The test is by name alone, so a shadowing variable elsewhere only
+// makes the answer more conservative. Declarations (`var x =`) and property
+// stores (`a.x =`) are not assignments to a variable.
+static std::unordered_set<std::string_view>
+reassignedNames(const std::string& source) {
+    std::unordered_set<std::string_view> names;
+    Scanner scanner(source);
+    Token beforePrevious{TokenType::EOF_, "", 0};
+    Token previous{TokenType::EOF_, "", 0};
+    for (Token token = scanner.scanOneToken(); token.type != TokenType::EOF_;
+         token = scanner.scanOneToken()) {
+        if (token.type == TokenType::EQUAL &&
+            previous.type == TokenType::IDENTIFIER &&
+            beforePrevious.type != TokenType::VAR &&
+            beforePrevious.type != TokenType::DOT) {
+            names.insert(previous.lexeme);
+        }
+        beforePrevious = previous;
+        previous = token;
+    }
+    return names;
+}
+
+ObjFunction* compile(const std::string& source, MemoryManager* mm,
+                     bool superinstructions, GlobalSlots* globals) {
     ObjFunction* fn = mm->create<ObjFunction>();
     auto parser = std::make_unique<Parser>(source);
     auto compiler = std::make_unique<Compiler>(fn, parser.get(), mm,
                                                FunctionType::SCRIPT, nullptr);
+    std::unordered_set<std::string_view> reassigned;
+    if (superinstructions) {
+        compiler->enableSuperinstructions();
+        reassigned = reassignedNames(source);
+        compiler->setReassignedNames(&reassigned);
+    }
+    compiler->setGlobalSlots(globals);
 
     while (!parser->check(TokenType::EOF_)) {
         compiler->declaration();
@@ -34,7 +70,12 @@ ObjFunction* compile(const std::string& source, MemoryManager* mm) {
 Compiler::Compiler(ObjFunction* function, Parser* parser, MemoryManager* mm,
                    FunctionType type, Compiler* enclosing)
     : m_function{function}, m_parser{parser}, m_mm{mm}, m_type{type},
-      m_enclosing{enclosing} {
+      m_enclosing{enclosing},
+      m_superinstructions{enclosing != nullptr &&
+                          enclosing->m_superinstructions},
+      m_globals{enclosing != nullptr ? enclosing->m_globals : nullptr},
+      m_reassignedNames{enclosing != nullptr ? enclosing->m_reassignedNames
+                                             : nullptr} {
     // Reserve slot 0: "this" for methods/initializers, empty name for others.
     // The empty name ensures resolveLocal never accidentally matches it for
     // non-method functions; "this" allows method bodies to capture the
@@ -69,6 +110,11 @@ void Compiler::markRoots(MemoryManager& mm) const {
 
 void Compiler::endCompiler() {
     emitReturn();
+    m_function->maxStackHeight =
+        std::max(m_maxStackHeight, m_function->arity + 1);
+    if (m_superinstructions) {
+        fuseSuperinstructions(*getCurrentChunk());
+    }
 #ifdef LOXPP_DEBUG_PRINT_CODE
     bool color = isatty(STDOUT_FILENO) != 0;
     const char* name =
@@ -182,7 +228,7 @@ void Compiler::number() {
     // passing it straight to std::stod would scan to the end of the whole
     // source — O(source length) per literal, i.e. O(N^2) over a large program.
     double num = std::stod(std::string(m_parser->m_previous.lexeme));
-    emitConstantOp(Op::CONSTANT, makeConstant(from<Number>(num)));
+    emitConstantOp(Op::CONSTANT, makeConstant(numberValue(num)));
 }
 
 void Compiler::string() {
@@ -456,7 +502,9 @@ void Compiler::addLocal(const Token& name) {
         m_parser->error("Too many local variables in function.");
         return;
     }
-    m_locals[m_localCount++] = Local{name, -1};
+    bool reassigned = m_reassignedNames == nullptr ||
+                      m_reassignedNames->contains(name.lexeme);
+    m_locals[m_localCount++] = Local{name, -1, false, reassigned};
 }
 
 int Compiler::resolveLocal(const Token& name) const {
@@ -473,7 +521,7 @@ int Compiler::resolveLocal(const Token& name) const {
     return -1;
 }
 
-int Compiler::addUpvalue(uint8_t index, bool isLocal) {
+int Compiler::addUpvalue(uint8_t index, bool isLocal, bool isFlat) {
     for (int i = 0; i < m_upvalueCount; i++) {
         if (m_upvalues[i].index == index && m_upvalues[i].isLocal == isLocal) {
             return i;
@@ -483,7 +531,7 @@ int Compiler::addUpvalue(uint8_t index, bool isLocal) {
         m_parser->error("Too many closure variables in function.");
         return 0;
     }
-    m_upvalues[m_upvalueCount] = {index, isLocal};
+    m_upvalues[m_upvalueCount] = {index, isLocal, isFlat};
     m_function->upvalueCount = m_upvalueCount + 1;
     return m_upvalueCount++;
 }
@@ -494,12 +542,21 @@ int Compiler::resolveUpvalue(const Token& name) {
     }
     int local = m_enclosing->resolveLocal(name);
     if (local != -1) {
-        m_enclosing->m_locals[local].isCaptured = true;
-        return addUpvalue(static_cast<uint8_t>(local), true);
+        // A local that is never written again is copied into the closure;
+        // only the others need an ObjUpvalue (and CLOSE_UPVALUE at scope
+        // exit). Its slot already holds its final value when CLOSURE runs:
+        // even a local function's own slot is filled before its captures.
+        Local& captured = m_enclosing->m_locals[local];
+        bool isFlat = !captured.isReassigned;
+        if (!isFlat) {
+            captured.isCaptured = true;
+        }
+        return addUpvalue(static_cast<uint8_t>(local), true, isFlat);
     }
     int upvalue = m_enclosing->resolveUpvalue(name);
     if (upvalue != -1) {
-        return addUpvalue(static_cast<uint8_t>(upvalue), false);
+        return addUpvalue(static_cast<uint8_t>(upvalue), false,
+                          m_enclosing->m_upvalues[upvalue].isFlat);
     }
     return -1;
 }
@@ -721,6 +778,8 @@ void Compiler::forInStatement(const Token& itemName) {
     addLocal(itemName);
     markInitialized();
     int itemSlot = m_localCount - 1;
+    // Rewritten on every iteration with no `=` in the source.
+    m_locals[itemSlot].isReassigned = true;
 
     // 3. Loop header (re-entry point for LOOP and continue).
     int loopStart = static_cast<int>(getCurrentChunk()->size());
@@ -1737,8 +1796,10 @@ void Compiler::funDeclaration() {
 
     emitConstantOp(Op::CLOSURE, makeConstant(Value{static_cast<Obj*>(fn)}));
     for (int i = 0; i < fn->upvalueCount; i++) {
-        emitByte(inner.m_upvalues[i].isLocal ? 1 : 0);
-        emitByte(inner.m_upvalues[i].index);
+        const Upvalue& up = inner.m_upvalues[i];
+        emitByte(static_cast<Byte>((up.isLocal ? kUpvalueLocal : 0) |
+                                   (up.isFlat ? kUpvalueFlat : 0)));
+        emitByte(up.index);
     }
     if (m_scopeDepth == 0) {
         emitConstantOp(Op::DEFINE_GLOBAL, nameConst);
@@ -1824,8 +1885,10 @@ void Compiler::method() {
 
     emitConstantOp(Op::CLOSURE, makeConstant(Value{static_cast<Obj*>(fn)}));
     for (int i = 0; i < fn->upvalueCount; i++) {
-        emitByte(inner.m_upvalues[i].isLocal ? 1 : 0);
-        emitByte(inner.m_upvalues[i].index);
+        const Upvalue& up = inner.m_upvalues[i];
+        emitByte(static_cast<Byte>((up.isLocal ? kUpvalueLocal : 0) |
+                                   (up.isFlat ? kUpvalueFlat : 0)));
+        emitByte(up.index);
     }
     emitConstantOp(Op::DEFINE_METHOD, nameConst);
 }
@@ -2045,6 +2108,7 @@ void Compiler::trackOperandStack(Op op) {
     case Op::GET_GLOBAL:
     case Op::GET_LOCAL:
     case Op::GET_UPVALUE:
+    case Op::GET_UPVALUE_FLAT:
     case Op::CLOSURE:
     case Op::CLASS:
         m_stackHeight++;
@@ -2099,12 +2163,33 @@ void Compiler::trackOperandStack(Op op) {
     case Op::BUILD_MAP:
         // Operand count is not known here; the caller adjusts m_stackHeight.
         break;
+    case Op::ADD_LOCALS:
+    case Op::LESS_LOCAL_CONST_JUMP:
+    case Op::INCR_LOCAL:
+    case Op::JUMP_IF_FALSE_POP:
+    case Op::FOR_ITER:
+    case Op::TAIL_CALL:
+    case Op::TAIL_INVOKE:
+        // Written only by the peephole pass, after emission has finished.
+        break;
+    case Op::ADD_NUM:
+    case Op::ADD_STR:
+    case Op::SUBTRACT_NUM:
+    case Op::MULTIPLY_NUM:
+    case Op::DIVIDE_NUM:
+    case Op::LESS_NUM:
+    case Op::GREATER_NUM:
+    case Op::INVOKE_LIST_APPEND:
+    case Op::INVOKE_LIST_POP:
+        // Written only by the VM while the chunk runs.
+        break;
     }
 }
 
 void Compiler::emitByte(Op op) {
     emitByte(static_cast<Byte>(op));
     trackOperandStack(op);
+    m_maxStackHeight = std::max(m_maxStackHeight, m_stackHeight);
 }
 
 void Compiler::emitBytes(Op op, Byte byte) {
@@ -2123,6 +2208,8 @@ void Compiler::emitBytes(Op op, Byte byte) {
     default:
         break;
     }
+    // An empty list or map literal pushes a cell here.
+    m_maxStackHeight = std::max(m_maxStackHeight, m_stackHeight);
 }
 
 int Compiler::emitJump(Op op) {
@@ -2185,9 +2272,28 @@ uint16_t Compiler::identifierConstant(const Token& name) {
 }
 
 void Compiler::emitConstantOp(Op op, uint16_t idx) {
+    int offset = static_cast<int>(getCurrentChunk()->size());
     emitByte(op);
     emitByte(static_cast<Byte>((idx >> 8) & 0xff));
     emitByte(static_cast<Byte>(idx & 0xff));
+    // Property sites get an inline cache (see InlineCache in chunk.h).
+    if ((op == Op::GET_PROPERTY || op == Op::SET_PROPERTY ||
+         op == Op::INVOKE) &&
+        !getCurrentChunk()->addInlineCache(offset)) {
+        m_parser->error("Too many property accesses in one chunk.");
+    }
+    if (m_globals != nullptr &&
+        (op == Op::GET_GLOBAL || op == Op::SET_GLOBAL ||
+         op == Op::DEFINE_GLOBAL)) {
+        Value name = getCurrentChunk()->getConstant(idx);
+        std::optional<uint16_t> slot =
+            m_globals->resolve(asObjString(as<Obj*>(name)));
+        if (!slot) {
+            m_parser->error("Too many global variables.");
+        } else {
+            getCurrentChunk()->setGlobalSlot(idx, *slot);
+        }
+    }
 }
 
 void Compiler::namedVariable(const Token& name, bool canAssign) {
@@ -2206,7 +2312,9 @@ void Compiler::namedVariable(const Token& name, bool canAssign) {
             expression();
             emitBytes(Op::SET_UPVALUE, static_cast<Byte>(slot));
         } else {
-            emitBytes(Op::GET_UPVALUE, static_cast<Byte>(slot));
+            emitBytes(m_upvalues[slot].isFlat ? Op::GET_UPVALUE_FLAT
+                                              : Op::GET_UPVALUE,
+                      static_cast<Byte>(slot));
         }
         return;
     }
@@ -7,15 +7,28 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class MemoryManager;
 class Compiler;
+class GlobalSlots;
 
 static constexpr int UINT8_COUNT = 256;
 
-ObjFunction* compile(const std::string& source, MemoryManager* mm);
+// Compiles `source` to the top-level script function, or nullptr on a
+// compile error. With `superinstructions`, every chunk also goes through the
+// peephole pass (peephole.h) — the VM wants that; the backends and the
+// bytecode tests want the canonical stream and leave it off. With `globals`,
+// every global-variable access also gets its slot in that table recorded in
+// the chunk (Chunk::setGlobalSlot); the bytecode itself is unchanged.
+// `superinstructions` also turns on capture flattening (GET_UPVALUE_FLAT),
+// which only the VM implements.
+ObjFunction* compile(const std::string& source, MemoryManager* mm,
+                     bool superinstructions = false,
+                     GlobalSlots* globals = nullptr);
 
 enum class FunctionType : std::uint8_t {
     SCRIPT,
@@ -32,12 +45,16 @@ struct ClassCompiler {
 struct Local {
     Token name;
     int depth; // -1 = declared but not yet initialized; >=0 = scope depth
-    bool isCaptured{false};
+    bool isCaptured{false}; // by reference, i.e. through an ObjUpvalue
+    // May be written after its initialization (see Compiler::addLocal); only
+    // a local that is not can be captured by value.
+    bool isReassigned{false};
 };
 
 struct Upvalue {
     uint8_t index;
     bool isLocal; // true = captures a local of the immediately enclosing fn
+    bool isFlat;  // true = the closure holds a copy of the value
 };
 
 struct LoopContext {
@@ -62,6 +79,14 @@ class Compiler {
     ~Compiler();
 
     Chunk* getCurrentChunk() const { return &m_function->chunk; }
+    // Run the superinstruction peephole on this chunk and every nested one.
+    void enableSuperinstructions() { m_superinstructions = true; }
+    // Resolve global names to slots of `globals` (see compile()).
+    void setGlobalSlots(GlobalSlots* globals) { m_globals = globals; }
+    // Capture never-reassigned locals by value (see compile()).
+    void setReassignedNames(const std::unordered_set<std::string_view>* names) {
+        m_reassignedNames = names;
+    }
     void endCompiler();
     void markRoots(MemoryManager& mm) const;
 
@@ -120,7 +145,7 @@ class Compiler {
 
     void addLocal(const Token& name);
     int resolveLocal(const Token& name) const;
-    int addUpvalue(uint8_t index, bool isLocal);
+    int addUpvalue(uint8_t index, bool isLocal, bool isFlat);
     int resolveUpvalue(const Token& name);
     void declareVariable();
     void markInitialized();
@@ -191,6 +216,11 @@ class Compiler {
     FunctionType m_type;
     Compiler* m_enclosing;
     ClassCompiler* m_currentClass{nullptr};
+    bool m_superinstructions; // inherited from the enclosing compiler
+    GlobalSlots* m_globals;   // likewise; see compile()
+    // Every name the source ever assigns to with `=`, or null when captures
+    // are not flattened. Inherited like m_globals; see compile().
+    const std::unordered_set<std::string_view>* m_reassignedNames;
 
     Local m_locals[UINT8_COUNT];
     int m_localCount{0};
@@ -203,6 +233,9 @@ class Compiler {
     // expression. Mirrors the backend's stackEffect table so the compiler's
     // view never drifts from the VM.
     int m_stackHeight{0};
+    // High-water mark of m_stackHeight, stored as
+    // ObjFunction::maxStackHeight by endCompiler().
+    int m_maxStackHeight{0};
     Upvalue m_upvalues[UINT8_COUNT];
     int m_upvalueCount{0};
     std::vector<LoopContext> m_loopStack;
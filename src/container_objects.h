@@ -58,6 +58,25 @@ inline bool isObjFile(Obj* o) { return isObjType(o, ObjType::FILE); }
 inline ObjFile* asObjFile(Obj* o) { return static_cast<ObjFile*>(o); }
 inline bool isFile(const Value& v) { return isValueOfType<ObjType::FILE>(v); }
 
+// ---------------------------------------------------------------------------
+// ObjStringBuilder — mutable text buffer made by StringBuilder(). append()
+// grows `chars` in place; build() interns a copy as an ObjString.
+// ---------------------------------------------------------------------------
+struct ObjStringBuilder : public Obj {
+    ObjClass* klass; // shared s_builderClass; GC-tracked
+    LoxString chars;
+
+    ObjStringBuilder(ObjClass* k, VmAllocator<char> alloc)
+        : Obj(ObjType::STRING_BUILDER), klass(k), chars(alloc) {}
+};
+
+inline ObjStringBuilder* asObjStringBuilder(Obj* o) {
+    return static_cast<ObjStringBuilder*>(o);
+}
+inline bool isStringBuilder(const Value& v) {
+    return isValueOfType<ObjType::STRING_BUILDER>(v);
+}
+
 // ---------------------------------------------------------------------------
 // ObjMap — open-addressing hash map with Value keys and values.
 // Keys must be Bool, Number, Nil, or String (interned).
@@ -94,15 +94,58 @@ static int closureInstruction(const char* name, const Chunk& chunk, int offset,
         << stringify(fnVal) << cc(color, kReset) << "')\n";
     offset += 3;
     for (int i = 0; i < fn->upvalueCount; i++) {
-        uint8_t isLocal = chunk.at(offset++);
+        uint8_t kind = chunk.at(offset++);
         uint8_t index = chunk.at(offset++);
         out << cc(color, kDim) << "           |  "
-            << (isLocal != 0U ? "local" : "upvalue") << ' '
-            << static_cast<int>(index) << cc(color, kReset) << '\n';
+            << ((kind & kUpvalueLocal) != 0U ? "local" : "upvalue") << ' '
+            << static_cast<int>(index)
+            << ((kind & kUpvalueFlat) != 0U ? " (flat)" : "")
+            << cc(color, kReset) << '\n';
     }
     return offset;
 }
 
+// A superinstruction (chunk.h) prints as one line carrying the operands of
+// the run it replaces, and the returned offset skips the whole run, since
+// that is what the VM executes. The run's original bytes are still in the
+// chunk for any jump that lands inside it.
+static int fusedInstruction(const char* name, const Chunk& chunk,
+                            const MemoryManager& mm, int offset,
+                            std::ostream& out, bool color) {
+    auto u16 = [&chunk](int at) {
+        return static_cast<uint16_t>(chunk.at(at) << 8 | chunk.at(at + 1));
+    };
+    auto constant = [&](int at) {
+        return stringify(chunk.getConstant(u16(at)));
+    };
+    out << cc(color, kBold) << name << cc(color, kReset) << ' ';
+    switch (toOpcode(chunk.at(offset))) {
+    case Op::ADD_LOCALS:
+        out << static_cast<int>(chunk.at(offset + 1)) << ' '
+            << static_cast<int>(chunk.at(offset + 3)) << '\n';
+        return offset + 5;
+    case Op::LESS_LOCAL_CONST_JUMP:
+        out << static_cast<int>(chunk.at(offset + 1)) << " ('"
+            << cc(color, kYellow) << constant(offset + 3) << cc(color, kReset)
+            << "') " << offset << " -> " << (offset + 9 + u16(offset + 7))
+            << '\n';
+        return offset + 10;
+    case Op::INCR_LOCAL:
+        out << static_cast<int>(chunk.at(offset + 1)) << " ('"
+            << cc(color, kYellow) << constant(offset + 3) << cc(color, kReset)
+            << "') " << static_cast<int>(chunk.at(offset + 7)) << '\n';
+        return offset + 9;
+    case Op::FOR_ITER:
+        out << static_cast<int>(chunk.at(offset + 1)) << ' '
+            << static_cast<int>(chunk.at(offset + 11)) << ' ' << offset
+            << " -> " << (offset + 6 + u16(offset + 4)) << '\n';
+        return offset + 13;
+    default: // JUMP_IF_FALSE_POP
+        out << offset << " -> " << (offset + 3 + u16(offset + 1)) << '\n';
+        return offset + 4;
+    }
+}
+
 void disassembleChunk(const Chunk& chunk, const MemoryManager& mm,
                       const char* name, std::ostream& out, bool color) {
     out << cc(color, kBold) << "== " << name << " ==" << cc(color, kReset)
@@ -226,6 +269,45 @@ int disassembleInstruction(const Chunk& chunk, const MemoryManager& mm,
         return constantInstruction("INSTANCEOF", chunk, mm, offset, out, color);
     case Op::IS_SEQ:
         return simpleInstruction("IS_SEQ", offset, out, color);
+    case Op::ADD_LOCALS:
+        return fusedInstruction("ADD_LOCALS", chunk, mm, offset, out, color);
+    case Op::LESS_LOCAL_CONST_JUMP:
+        return fusedInstruction("LESS_LOCAL_CONST_JUMP", chunk, mm, offset,
+                                out, color);
+    case Op::INCR_LOCAL:
+        return fusedInstruction("INCR_LOCAL", chunk, mm, offset, out, color);
+    case Op::JUMP_IF_FALSE_POP:
+        return fusedInstruction("JUMP_IF_FALSE_POP", chunk, mm, offset, out,
+                                color);
+    case Op::FOR_ITER:
+        return fusedInstruction("FOR_ITER", chunk, mm, offset, out, color);
+    case Op::ADD_NUM:
+        return simpleInstruction("ADD_NUM", offset, out, color);
+    case Op::ADD_STR:
+        return simpleInstruction("ADD_STR", offset, out, color);
+    case Op::SUBTRACT_NUM:
+        return simpleInstruction("SUBTRACT_NUM", offset, out, color);
+    case Op::MULTIPLY_NUM:
+        return simpleInstruction("MULTIPLY_NUM", offset, out, color);
+    case Op::DIVIDE_NUM:
+        return simpleInstruction("DIVIDE_NUM", offset, out, color);
+    case Op::LESS_NUM:
+        return simpleInstruction("LESS_NUM", offset, out, color);
+    case Op::GREATER_NUM:
+        return simpleInstruction("GREATER_NUM", offset, out, color);
+    case Op::INVOKE_LIST_APPEND:
+        return invokeInstruction("INVOKE_LIST_APPEND", chunk, mm, offset, out,
+                                 color);
+    case Op::INVOKE_LIST_POP:
+        return invokeInstruction("INVOKE_LIST_POP", chunk, mm, offset, out,
+                                 color);
+    case Op::GET_UPVALUE_FLAT:
+        return byteInstruction("GET_UPVALUE_FLAT", chunk, offset, out, color);
+    // Not fused: the RETURN after a tail call is listed on its own line.
+    case Op::TAIL_CALL:
+        return byteInstruction("TAIL_CALL", chunk, offset, out, color);
+    case Op::TAIL_INVOKE:
+        return invokeInstruction("TAIL_INVOKE", chunk, mm, offset, out, color);
     default:
         out << cc(color, kRed) << cc(color, kBold) << "UNKNOWN("
             << static_cast<unsigned>(chunk.at(offset)) << ")"
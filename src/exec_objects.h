@@ -17,6 +17,10 @@ void nativeRuntimeError(const char* msg);
 struct ObjFunction : public Obj {
     int arity{0};
     int upvalueCount{0};
+    // Most stack cells a call of this function occupies at once, counting
+    // slot 0 and the parameters. VM::call reserves this much on entry, so
+    // pushes inside the body need no bounds check.
+    int maxStackHeight{0};
     ObjString* name{nullptr}; // null for top-level script
     Chunk chunk;
 
@@ -47,7 +51,10 @@ inline ObjUpvalue* asObjUpvalue(Obj* o) { return static_cast<ObjUpvalue*>(o); }
 
 struct ObjClosure : public Obj {
     ObjFunction* function;
-    std::vector<ObjUpvalue*> upvalues;
+    std::vector<ObjUpvalue*> upvalues; // null for a flattened capture
+    // Values of the flattened captures (kUpvalueFlat), by upvalue slot; empty
+    // when the function has none.
+    std::vector<Value> captured;
     int upvalueCount;
 
     explicit ObjClosure(ObjFunction* fn)
@@ -0,0 +1,33 @@
+#include "global_slots.h"
+
+std::optional<uint16_t> GlobalSlots::resolve(ObjString* name) {
+    Value slot;
+    if (m_index.get(name, slot)) {
+        return static_cast<uint16_t>(as<Number>(slot));
+    }
+    if (m_values.size() == kMaxSlots) {
+        return std::nullopt;
+    }
+    auto next = static_cast<uint16_t>(m_values.size());
+    // Grow the arrays first: the table insertion may collect, and the GC
+    // walks m_names/m_values in lockstep.
+    m_names.push_back(name);
+    m_values.push_back(undefined());
+    m_index.set(name, Value{static_cast<Number>(next)});
+    return next;
+}
+
+void GlobalSlots::define(ObjString* name, Value value) {
+    if (std::optional<uint16_t> slot = resolve(name)) {
+        m_values[*slot] = value;
+    }
+}
+
+bool GlobalSlots::get(ObjString* name, Value& out) const {
+    Value slot;
+    if (!m_index.get(name, slot)) {
+        return false;
+    }
+    out = m_values[static_cast<size_t>(as<Number>(slot))];
+    return !isUndefined(out);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "table.h"
+#include "value.h"
+#include "vm_allocator.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Global variables, stored by slot index. The compiler resolves every global
+// name to a slot (resolve()) and records it in the chunk next to the name's
+// constant (Chunk::setGlobalSlot), so GET_GLOBAL/SET_GLOBAL/DEFINE_GLOBAL
+// index an array instead of hashing the name. Slots are stable for the
+// lifetime of the VM: a name compiled in one REPL line and defined in the
+// next maps to the same slot.
+//
+// A slot that has been resolved but not yet defined holds undefined(), which
+// the VM reports as "Undefined variable" exactly as the by-name lookup did.
+class GlobalSlots {
+  public:
+    static constexpr uint32_t kMaxSlots = UINT16_MAX + 1;
+
+    explicit GlobalSlots(VmAllocator<Entry> alloc) : m_index(alloc) {}
+
+    // Slot of `name`, allocating an undefined one on first use; nullopt when
+    // all kMaxSlots are taken.
+    std::optional<uint16_t> resolve(ObjString* name);
+    // Defines `name` outside compiled code (natives, stdlib modules).
+    void define(ObjString* name, Value value);
+    // By-name read for VM::getGlobal() and INSTANCEOF; false if undefined.
+    bool get(ObjString* name, Value& out) const;
+
+    Value& operator[](uint16_t slot) { return m_values[slot]; }
+
+    static Value undefined() { return Value{static_cast<Obj*>(nullptr)}; }
+    static bool isUndefined(const Value& v) {
+        return is<Obj*>(v) && as<Obj*>(v) == nullptr;
+    }
+
+    // Visits every slot, defined or not: names must stay alive (and interned)
+    // so that recompiling a name finds its slot again.
+    template <typename F>
+    void forEach(F&& fn) const {
+        for (size_t i = 0; i < m_values.size(); i++) {
+            fn(m_names[i], m_values[i]);
+        }
+    }
+
+  private:
+    Table m_index; // ObjString* -> slot number
+    std::vector<ObjString*> m_names;
+    std::vector<Value> m_values;
+};
@@ -2,6 +2,8 @@
 #include "scanner.h"
 #include "vm.h"
 
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -304,17 +306,34 @@ int main(int argc, const char* argv[]) {
 
     VM vm;
 
-    if (argc == 1) {
+    // loxpp --max-stack <frames> [path] — raises or lowers the call-depth
+    // limit (VM::kDefaultMaxFrames). Only recognized as the first argument,
+    // so everything after the script path still goes to args() untouched.
+    int first = 1;
+    if (argc >= 2 && std::string(argv[1]) == "--max-stack") {
+        char* end = nullptr;
+        long frames = argc >= 3 ? std::strtol(argv[2], &end, 10) : 0;
+        if (end == nullptr || *end != '\0' || frames < 1 ||
+            frames > 100000000) {
+            std::fprintf(stderr,
+                         "Usage: loxpp [--max-stack <frames>] [path]\n");
+            return 64;
+        }
+        vm.setMaxStackDepth(static_cast<int>(frames));
+        first = 3;
+    }
+
+    if (argc == first) {
         repl(vm);
         return 0;
     }
 
     std::vector<std::string> progArgs;
-    for (int i = 2; i < argc; i++) {
+    for (int i = first + 1; i < argc; i++) {
         progArgs.emplace_back(argv[i]);
     }
     vm.setArgs(std::move(progArgs));
-    runFile(vm, argv[1]);
+    runFile(vm, argv[first]);
 
     return 0;
 }
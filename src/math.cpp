@@ -24,6 +24,17 @@ static Value unaryMath(int /*argc*/, Value* args) {
     return from<Number>(F(as<Number>(args[0])));
 }
 
+// For functions whose result is integral (floor, ceil, round): the result
+// takes the int32 tag when it fits, like an integer literal.
+template <UnaryFn F>
+static Value integralMath(int /*argc*/, Value* args) {
+    if (!is<Number>(args[0])) {
+        nativeRuntimeError("math function argument must be a number.");
+        return from<Nil>(Nil{});
+    }
+    return numberValue(F(as<Number>(args[0])));
+}
+
 template <BinaryFn F>
 static Value binaryMath(int /*argc*/, Value* args) {
     if (!is<Number>(args[0]) || !is<Number>(args[1])) {
@@ -62,8 +73,10 @@ static double wrap_fmax(double x, double y) { return std::fmax(x, y); }
 // ---------------------------------------------------------------------------
 
 const MathFnEntry kMathFunctions[] = {
-    {"abs", unaryMath<wrap_abs>, 1},      {"ceil", unaryMath<wrap_ceil>, 1},
-    {"floor", unaryMath<wrap_floor>, 1},  {"round", unaryMath<wrap_round>, 1},
+    {"abs", unaryMath<wrap_abs>, 1},
+    {"ceil", integralMath<wrap_ceil>, 1},
+    {"floor", integralMath<wrap_floor>, 1},
+    {"round", integralMath<wrap_round>, 1},
     {"sqrt", unaryMath<wrap_sqrt>, 1},    {"cbrt", unaryMath<wrap_cbrt>, 1},
     {"exp", unaryMath<wrap_exp>, 1},      {"log", unaryMath<wrap_log>, 1},
     {"log2", unaryMath<wrap_log2>, 1},    {"log10", unaryMath<wrap_log10>, 1},
@@ -10,6 +10,7 @@
 #endif
 
 #include <cstdio>
+#include <string>
 
 #ifdef LOXPP_DEBUG_LOG_GC
 static const char* objTypeName(ObjType type) {
@@ -34,6 +35,8 @@ static const char* objTypeName(ObjType type) {
         return "list";
     case ObjType::FILE:
         return "file";
+    case ObjType::STRING_BUILDER:
+        return "string_builder";
     case ObjType::ITERATOR:
         return "iterator";
     case ObjType::MAP:
@@ -63,6 +66,22 @@ void* MemoryManager::rawAlloc(std::size_t bytes) {
     return ::operator new(bytes);
 }
 
+ObjInstance* MemoryManager::createInstance(ObjClass* klass) {
+#ifdef LOXPP_STRESS_GC
+    collectGarbage(); // fire on every allocation to surface rooting bugs
+#else
+    if (bytesAllocated > m_nextGC) {
+        collectGarbage();
+    }
+#endif
+    uint32_t inlineSlots = klass->inlineSlotHint;
+    bytesAllocated += sizeof(ObjInstance) + inlineSlots * sizeof(Value);
+    auto* p = new (inlineSlots) ObjInstance(klass, m_shapes.root(),
+                                            inlineSlots, VmAllocator<Value>{this});
+    allObjects.push_back(p);
+    return p;
+}
+
 void MemoryManager::release(Obj* obj, std::size_t size) {
     bytesAllocated -= size;
     delete obj;
@@ -98,6 +117,26 @@ ObjString* MemoryManager::makeString(std::string&& sv) {
     return s;
 }
 
+ObjString* MemoryManager::concat(ObjString* a, ObjString* b) {
+    if (a->length + b->length >= ObjString::kMinRopeLength) {
+        return create<ObjString>(a, b, VmAllocator<char>{this});
+    }
+    // Both are shorter than a rope, so both are flat.
+    std::string result;
+    result.reserve(a->length + b->length);
+    result.append(a->chars.data(), a->chars.size());
+    result.append(b->chars.data(), b->chars.size());
+    return makeString(std::move(result));
+}
+
+ObjString* MemoryManager::smallIntString(int n) {
+    ObjString*& s = m_smallIntStrings[static_cast<std::size_t>(n)];
+    if (s == nullptr) {
+        s = makeString(std::to_string(n));
+    }
+    return s;
+}
+
 ObjString* MemoryManager::findString(std::string_view sv) const {
     uint32_t hash = hashString(sv);
     return m_strings.findString(sv.data(), static_cast<int>(sv.size()), hash);
@@ -152,8 +191,14 @@ void MemoryManager::traceObject(Obj* obj) {
             stringifyObj(obj).c_str());
 #endif
     switch (obj->type) {
-    case ObjType::STRING:
+    case ObjType::STRING: {
+        auto* str = static_cast<ObjString*>(obj);
+        if (str->isRope()) {
+            markObject(str->left);
+            markObject(str->right);
+        }
         break;
+    }
     case ObjType::NATIVE:
         break;
     case ObjType::UPVALUE:
@@ -166,6 +211,14 @@ void MemoryManager::traceObject(Obj* obj) {
         for (uint16_t i = 0; i < consts.size(); i++) {
             markValue(consts.at(i));
         }
+        // Strong references: a cached class must not be freed and its
+        // address reused by a new class while an entry still names it.
+        for (const InlineCache& ic : fn->chunk.inlineCaches()) {
+            for (int i = 0; i < ic.count; i++) {
+                markObject(ic.entries[i].klass);
+                markValue(ic.entries[i].method);
+            }
+        }
         break;
     }
     case ObjType::CLOSURE: {
@@ -174,6 +227,9 @@ void MemoryManager::traceObject(Obj* obj) {
         for (auto* uv : cl->upvalues) {
             markObject(uv);
         }
+        for (const Value& v : cl->captured) {
+            markValue(v);
+        }
         break;
     }
     case ObjType::CLASS: {
@@ -191,10 +247,17 @@ void MemoryManager::traceObject(Obj* obj) {
     case ObjType::INSTANCE: {
         auto* inst = static_cast<ObjInstance*>(obj);
         markObject(inst->klass);
-        inst->fields.forEach([this](ObjString* k, Value v) {
-            markObject(k);
-            markValue(v);
-        });
+        // Shape keys are roots (see collectGarbage), so only values here.
+        if (inst->dictionary) {
+            inst->dictionary->forEach([this](ObjString* k, Value v) {
+                markObject(k);
+                markValue(v);
+            });
+        } else {
+            for (uint32_t i = 0; i < inst->shape->slotCount(); i++) {
+                markValue(inst->slot(i));
+            }
+        }
         break;
     }
     case ObjType::BOUND_METHOD: {
@@ -213,6 +276,9 @@ void MemoryManager::traceObject(Obj* obj) {
     case ObjType::FILE:
         markObject(static_cast<ObjFile*>(obj)->klass);
         break;
+    case ObjType::STRING_BUILDER:
+        markObject(static_cast<ObjStringBuilder*>(obj)->klass);
+        break;
     case ObjType::ITERATOR:
         markValue(static_cast<ObjIterator*>(obj)->collection);
         break;
@@ -244,8 +310,9 @@ void MemoryManager::traceObject(Obj* obj) {
 
 void MemoryManager::removeWhiteStrings() { m_strings.removeUnmarkedKeys(); }
 
-// Returns the sizeof(T) used when the object was created via create<T>().
-// Must match the sizeof(T) added in create<T>().
+// Returns the sizeof(T) used when the object was created via create<T>()
+// (plus the inline slots of an instance from createInstance()). Must match
+// what those added to bytesAllocated.
 static std::size_t objAllocatedSize(Obj* obj) {
     switch (obj->type) {
     case ObjType::STRING:
@@ -261,13 +328,16 @@ static std::size_t objAllocatedSize(Obj* obj) {
     case ObjType::CLASS:
         return sizeof(ObjClass);
     case ObjType::INSTANCE:
-        return sizeof(ObjInstance);
+        return sizeof(ObjInstance) +
+               static_cast<ObjInstance*>(obj)->inlineSlots * sizeof(Value);
     case ObjType::BOUND_METHOD:
         return sizeof(ObjBoundMethod);
     case ObjType::LIST:
         return sizeof(ObjList);
     case ObjType::FILE:
         return sizeof(ObjFile);
+    case ObjType::STRING_BUILDER:
+        return sizeof(ObjStringBuilder);
     case ObjType::ITERATOR:
         return sizeof(ObjIterator);
     case ObjType::MAP:
@@ -322,6 +392,15 @@ void MemoryManager::collectGarbage() {
     for (auto* obj : m_tempRoots) {
         markObject(obj);
     }
+    // Shapes outlive the instances that use them and compare keys by
+    // pointer, so their keys must never be freed and re-interned elsewhere.
+    m_shapes.forEachKey([this](ObjString* key) { markObject(key); });
+    for (ObjString* s : m_charStrings) {
+        markObject(s);
+    }
+    for (ObjString* s : m_smallIntStrings) {
+        markObject(s);
+    }
     traceReferences();
     removeWhiteStrings();
     sweep();
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "object.h"
+#include "shape.h"
 #include "table.h"
 #include "vm_allocator.h"
 
+#include <array>
 #include <functional>
 #include <string_view>
 #include <vector>
@@ -14,6 +16,8 @@ struct ProfilerData; // defined in profiler.h, included only in
 #endif
 
 class Compiler;
+struct ObjClass;
+struct ObjInstance;
 
 class MemoryManager : public VmAllocBase {
   public:
@@ -42,6 +46,10 @@ class MemoryManager : public VmAllocBase {
         return p;
     }
 
+    // Creates an ObjInstance of `klass` with no fields; its inline slot
+    // count comes from klass->inlineSlotHint (see ObjInstance).
+    ObjInstance* createInstance(ObjClass* klass);
+
     void release(Obj* obj, std::size_t size);
 
     // Returns an interned ObjString, creating one if not already present.
@@ -51,6 +59,33 @@ class MemoryManager : public VmAllocBase {
         return makeString(std::string_view{chars});
     }
     [[nodiscard]] ObjString* findString(std::string_view sv) const;
+    // Returns a + b: interned when short, otherwise a rope over a and b that
+    // defers the copy and the hash (see ObjString). a and b must be rooted.
+    ObjString* concat(ObjString* a, ObjString* b);
+    // ObjString::flatten with s rooted for the duration.
+    void flatten(ObjString* s) {
+        if (s->isRope()) {
+            pushTempRoot(s);
+            s->flatten();
+            popTempRoot();
+        }
+    }
+
+    // Interned one-byte strings and decimal forms of small non-negative
+    // integers. Each is made on first use and then kept for the
+    // MemoryManager's lifetime, so later lookups skip the hash and the
+    // intern-table probe.
+    static constexpr int kSmallIntStrings = 1024;
+    ObjString* charString(char c) {
+        ObjString*& s = m_charStrings[static_cast<unsigned char>(c)];
+        if (s == nullptr) {
+            s = makeString(std::string_view{&c, 1});
+        }
+        return s;
+    }
+    ObjString* smallIntString(int n); // 0 <= n < kSmallIntStrings
+
+    ShapeTree& shapes() { return m_shapes; }
 
     void collectAll();
 
@@ -78,6 +113,9 @@ class MemoryManager : public VmAllocBase {
     // inside rawAlloc when push_back triggers a reallocation.
     std::vector<Obj*> allObjects;
     Table m_strings;
+    ShapeTree m_shapes;
+    std::array<ObjString*, 256> m_charStrings{};
+    std::array<ObjString*, kSmallIntStrings> m_smallIntStrings{};
 
     std::vector<Obj*> m_grayStack;
     std::vector<Obj*> m_tempRoots; // objects transiently protected from GC
@@ -3,13 +3,86 @@
 #include "table.h"
 
 #include <algorithm>
+#include <cstring>
 #include <string>
+#include <vector>
+
+// Calls fn with each flat piece of s's text, left to right. Walks with an
+// explicit stack: a string built by appending in a loop is a rope as deep as
+// the number of appends.
+template <typename Fn>
+static void forEachPiece(const ObjString* s, Fn&& fn) {
+    std::vector<const ObjString*> pending{s};
+    while (!pending.empty()) {
+        const ObjString* node = pending.back();
+        pending.pop_back();
+        if (node->isRope()) {
+            pending.push_back(node->right);
+            pending.push_back(node->left);
+        } else {
+            fn(std::string_view{node->chars.data(), node->chars.size()});
+        }
+    }
+}
+
+void ObjString::flatten() {
+    if (!isRope()) {
+        return;
+    }
+    chars.reserve(length); // may collect; left and right are still traced
+    forEachPiece(this, [this](std::string_view piece) {
+        chars.append(piece.data(), piece.size());
+    });
+    left = nullptr;
+    right = nullptr;
+}
+
+uint32_t ObjString::hashCode() {
+    if (!hashed) {
+        uint32_t h = 2166136261U;
+        forEachPiece(this, [&h](std::string_view piece) {
+            for (unsigned char c : piece) {
+                h ^= c;
+                h *= 16777619U;
+            }
+        });
+        hash = h;
+        hashed = true;
+    }
+    return hash;
+}
+
+void ObjString::appendTo(std::string& out) const {
+    out.reserve(out.size() + length);
+    forEachPiece(this, [&out](std::string_view piece) { out += piece; });
+}
+
+bool stringsEqual(ObjString* a, ObjString* b) {
+    if (a == b) {
+        return true;
+    }
+    if ((a->interned && b->interned) || a->length != b->length) {
+        return false;
+    }
+    if (a->hashed && b->hashed && a->hash != b->hash) {
+        return false;
+    }
+    if (!a->isRope() && !b->isRope()) {
+        return std::memcmp(a->chars.data(), b->chars.data(), a->length) == 0;
+    }
+    std::string x;
+    std::string y;
+    a->appendTo(x);
+    b->appendTo(y);
+    return x == y;
+}
 
 std::string stringifyObj(Obj* obj) {
     switch (obj->type) {
     case ObjType::STRING: {
-        const auto& s = asObjString(obj)->chars;
-        return {s.data(), s.size()};
+        std::string s;
+        asObjString(obj)->appendTo(s);
+        return s;
     }
     case ObjType::FUNCTION: {
         auto* fn = asObjFunction(obj);
@@ -53,6 +126,8 @@ std::string stringifyObj(Obj* obj) {
     }
     case ObjType::FILE:
         return "<file>";
+    case ObjType::STRING_BUILDER:
+        return "<string builder>";
     case ObjType::ITERATOR:
         return "<iterator>";
     case ObjType::LIST: {
@@ -21,6 +21,7 @@ enum class ObjType : uint8_t {
     MAP,
     ENUM_CTOR,
     ENUM,
+    STRING_BUILDER,
 };
 
 inline uint32_t hashString(std::string_view s) {
@@ -39,14 +40,45 @@ struct Obj {
     virtual ~Obj() = default;
 };
 
+// A string is either flat — its text is in `chars` — or a rope: `chars` is
+// empty and the text is left's followed by right's. Flat strings made by
+// MemoryManager::makeString are interned, so two of them are equal only if
+// they are the same object. Ropes come from concatenating long strings (see
+// MemoryManager::concat) and are never interned: they are hashed lazily and
+// compared by content, and flatten() turns one into a flat string in place.
 struct ObjString : public Obj {
+    // Concatenations at least this long make a rope instead of copying.
+    static constexpr uint32_t kMinRopeLength = 64;
+
     uint32_t hash{0};
+    uint32_t length{0};
     LoxString chars;
+    ObjString* left{nullptr};
+    ObjString* right{nullptr};
+    bool interned{true};
+    bool hashed{true};
 
     ObjString(std::string_view sv, VmAllocator<char> alloc)
-        : Obj(ObjType::STRING), hash(hashString(sv)), chars(sv, alloc) {}
+        : Obj(ObjType::STRING), hash(hashString(sv)),
+          length(static_cast<uint32_t>(sv.size())), chars(sv, alloc) {}
+    ObjString(ObjString* l, ObjString* r, VmAllocator<char> alloc)
+        : Obj(ObjType::STRING), length(l->length + r->length), chars(alloc),
+          left(l), right(r), interned(false), hashed(false) {}
+
+    [[nodiscard]] bool isRope() const { return left != nullptr; }
+
+    // Copies the rope's text into `chars` and drops its children. Allocates
+    // through the VM allocator, so the caller must keep this string rooted
+    // (MemoryManager::flatten does).
+    void flatten();
+    uint32_t hashCode();
+    // Appends the text to `out` without allocating from the VM heap, so it
+    // is safe on an unrooted string.
+    void appendTo(std::string& out) const;
 };
 
+bool stringsEqual(ObjString* a, ObjString* b);
+
 std::string stringifyObj(Obj* obj);
 
 inline bool isObjType(Obj* obj, ObjType type) { return obj->type == type; }
@@ -0,0 +1,105 @@
+#include "peephole.h"
+
+#include "exec_objects.h"
+
+#include <array>
+#include <cstddef>
+
+namespace {
+
+// Length in bytes of the instruction at `offset`. Must agree with
+// disassembleInstruction (debug.cpp) and decodeOne (chunk_decoder.cpp).
+int instructionLength(const Chunk& chunk, int offset) {
+    switch (canonicalOp(toOpcode(chunk.at(offset)))) {
+    case Op::CONSTANT:
+    case Op::DEFINE_GLOBAL:
+    case Op::GET_GLOBAL:
+    case Op::SET_GLOBAL:
+    case Op::CLASS:
+    case Op::GET_PROPERTY:
+    case Op::SET_PROPERTY:
+    case Op::DEFINE_METHOD:
+    case Op::GET_SUPER:
+    case Op::INSTANCEOF:
+    case Op::JUMP:
+    case Op::JUMP_IF_FALSE:
+    case Op::LOOP:
+        return 3;
+    case Op::GET_LOCAL:
+    case Op::SET_LOCAL:
+    case Op::CALL:
+    case Op::BUILD_LIST:
+    case Op::BUILD_MAP:
+    case Op::GET_UPVALUE:
+    case Op::SET_UPVALUE:
+        return 2;
+    case Op::INVOKE:
+    case Op::SUPER_INVOKE:
+        return 4;
+    case Op::CLOSURE: {
+        auto idx = static_cast<uint16_t>(chunk.at(offset + 1) << 8 |
+                                         chunk.at(offset + 2));
+        ObjFunction* fn = asObjFunction(chunk.getConstant(idx));
+        return 3 + (2 * fn->upvalueCount);
+    }
+    case Op::JUMP_TABLE:
+        return 3 + (2 * chunk.at(offset + 2));
+    default:
+        return 1;
+    }
+}
+
+// One fusible run: the fused opcode and the canonical ops it replaces.
+struct Pattern {
+    Op fused;
+    std::array<Op, 8> ops;
+    std::size_t length;
+};
+
+// Longest first, so a run that could match two patterns takes the bigger.
+constexpr std::array<Pattern, 7> kPatterns{{
+    {Op::FOR_ITER,
+     {Op::GET_LOCAL, Op::ITER_HAS_NEXT, Op::JUMP_IF_FALSE, Op::POP,
+      Op::GET_LOCAL, Op::ITER_NEXT, Op::SET_LOCAL, Op::POP},
+     8},
+    {Op::LESS_LOCAL_CONST_JUMP,
+     {Op::GET_LOCAL, Op::CONSTANT, Op::LESS, Op::JUMP_IF_FALSE, Op::POP},
+     5},
+    {Op::INCR_LOCAL,
+     {Op::GET_LOCAL, Op::CONSTANT, Op::ADD, Op::SET_LOCAL, Op::POP},
+     5},
+    {Op::ADD_LOCALS, {Op::GET_LOCAL, Op::GET_LOCAL, Op::ADD}, 3},
+    {Op::JUMP_IF_FALSE_POP, {Op::JUMP_IF_FALSE, Op::POP}, 2},
+    {Op::TAIL_CALL, {Op::CALL, Op::RETURN}, 2},
+    {Op::TAIL_INVOKE, {Op::INVOKE, Op::RETURN}, 2},
+}};
+
+bool matches(const Chunk& chunk, int offset, const Pattern& pattern) {
+    int size = static_cast<int>(chunk.size());
+    for (std::size_t i = 0; i < pattern.length; i++) {
+        if (offset >= size || toOpcode(chunk.at(offset)) != pattern.ops[i]) {
+            return false;
+        }
+        offset += instructionLength(chunk, offset);
+    }
+    return true;
+}
+
+} // namespace
+
+void fuseSuperinstructions(Chunk& chunk) {
+    int size = static_cast<int>(chunk.size());
+    // Every instruction boundary is tried, including ones inside a run that
+    // was just fused: a jump may land there, and it then executes the
+    // original bytes, which may themselves start a shorter fusible run.
+    for (int offset = 0; offset < size;) {
+        int length = instructionLength(chunk, offset);
+        for (const Pattern& pattern : kPatterns) {
+            if (matches(chunk, offset, pattern)) {
+                chunk.patch(offset, static_cast<Byte>(pattern.fused));
+                break;
+            }
+        }
+        offset += length;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "chunk.h"
+
+// Rewrites the hot opcode runs listed under "Superinstructions" in chunk.h
+// into their fused forms, in place. Only head opcode bytes change — the
+// chunk's size, operands, jump offsets and line table are untouched — so
+// it is safe to run once per chunk as soon as the compiler has finished it
+// (Compiler::endCompiler). The set was picked from the opcode-pair counts
+// the LOXPP_PROFILE build reports ("Hot Opcode Pairs"). The same pass marks
+// tail calls ("Tail calls" in chunk.h).
+void fuseSuperinstructions(Chunk& chunk);
@@ -45,18 +45,39 @@ struct GcStats {
     std::vector<GcEventRecord> events; // capped at 1024 entries
 };
 
+// One property site's inline cache (InlineCache in chunk.h).
+struct InlineCacheStats {
+    std::string function;
+    int line{0};
+    Op op{Op::GET_PROPERTY};
+    std::string property;
+    uint64_t hits{0};
+    uint64_t misses{0};
+    int entries{0}; // cached receivers after the latest miss
+    bool megamorphic{false};
+};
+
 struct ProfilerData {
+    // Opcode table width; must cover every Op (checked below).
+    static constexpr int kOpcodeSlots = 128;
+
     // Per-opcode dispatch counts. Indexed by static_cast<uint8_t>(Op).
-    // Array size 64 is larger than the current opcode count (42) for headroom.
-    std::array<OpcodeStats, 64> opcodeTable{};
+    std::array<OpcodeStats, kOpcodeSlots> opcodeTable{};
+
+    // Dynamic opcode-pair counts: pairTable[prev * kOpcodeSlots + next] is how
+    // often `next` was dispatched straight after `prev`. Drives the choice of
+    // superinstructions. Heap-allocated to keep VM objects small.
+    std::vector<uint64_t> pairTable =
+        std::vector<uint64_t>(kOpcodeSlots * kOpcodeSlots);
+    int lastOpcode{-1}; // previous dispatch, -1 before the first
+
+    // Per-site inline-cache stats, in order of first execution. Indexed by
+    // InlineCache::profileSlot.
+    std::vector<InlineCacheStats> inlineCaches;
 
     // Per-function stats. Key is ObjFunction* (stable for program lifetime).
     std::unordered_map<ObjFunction*, FunctionStats> funcTable;
 
-    // Per-frame call-entry timestamps, parallel to VM::m_frames[].
-    // Size matches VM::FRAMES_MAX = 64.
-    std::array<int64_t, 64> frameEnterNs{};
-
     GcStats gc{};
     int64_t programStartNs{0};
     int64_t programEndNs{0};
@@ -67,9 +88,19 @@ struct ProfilerData {
         return ts.tv_sec * int64_t{1'000'000'000} + ts.tv_nsec;
     }
 
+    void countOpcode(uint8_t op) {
+        opcodeTable[op].count++;
+        if (lastOpcode >= 0)
+            pairTable[(lastOpcode * kOpcodeSlots) + op]++;
+        lastOpcode = op;
+    }
+
     void report(std::FILE* out) const;
 };
 
+static_assert(OP_COUNT <= ProfilerData::kOpcodeSlots,
+              "ProfilerData::kOpcodeSlots must cover every opcode");
+
 // ---------------------------------------------------------------------------
 // Opcode name table (used by report())
 // ---------------------------------------------------------------------------
@@ -154,12 +185,66 @@ inline const char* opcodeName(Op op) {
         return "SUPER_INVOKE";
     case Op::BUILD_LIST:
         return "BUILD_LIST";
+    case Op::BUILD_MAP:
+        return "BUILD_MAP";
     case Op::GET_INDEX:
         return "GET_INDEX";
     case Op::SET_INDEX:
         return "SET_INDEX";
+    case Op::SLICE:
+        return "SLICE";
     case Op::IN:
         return "IN";
+    case Op::GET_ITER:
+        return "GET_ITER";
+    case Op::ITER_HAS_NEXT:
+        return "ITER_HAS_NEXT";
+    case Op::ITER_NEXT:
+        return "ITER_NEXT";
+    case Op::MATCH_ERROR:
+        return "MATCH_ERROR";
+    case Op::JUMP_TABLE:
+        return "JUMP_TABLE";
+    case Op::GET_TAG:
+        return "GET_TAG";
+    case Op::INSTANCEOF:
+        return "INSTANCEOF";
+    case Op::IS_SEQ:
+        return "IS_SEQ";
+    case Op::ADD_LOCALS:
+        return "ADD_LOCALS";
+    case Op::LESS_LOCAL_CONST_JUMP:
+        return "LESS_LOCAL_CONST_JUMP";
+    case Op::INCR_LOCAL:
+        return "INCR_LOCAL";
+    case Op::JUMP_IF_FALSE_POP:
+        return "JUMP_IF_FALSE_POP";
+    case Op::FOR_ITER:
+        return "FOR_ITER";
+    case Op::ADD_NUM:
+        return "ADD_NUM";
+    case Op::ADD_STR:
+        return "ADD_STR";
+    case Op::SUBTRACT_NUM:
+        return "SUBTRACT_NUM";
+    case Op::MULTIPLY_NUM:
+        return "MULTIPLY_NUM";
+    case Op::DIVIDE_NUM:
+        return "DIVIDE_NUM";
+    case Op::LESS_NUM:
+        return "LESS_NUM";
+    case Op::GREATER_NUM:
+        return "GREATER_NUM";
+    case Op::INVOKE_LIST_APPEND:
+        return "INVOKE_LIST_APPEND";
+    case Op::INVOKE_LIST_POP:
+        return "INVOKE_LIST_POP";
+    case Op::GET_UPVALUE_FLAT:
+        return "GET_UPVALUE_FLAT";
+    case Op::TAIL_CALL:
+        return "TAIL_CALL";
+    case Op::TAIL_INVOKE:
+        return "TAIL_INVOKE";
     default:
         return "UNKNOWN";
     }
@@ -214,7 +299,7 @@ class ProfileGcScope {
 //              and subtracts elapsed from the parent's selfNs (Graham 1982
 //              self-time algorithm).
 //
-// Stored in std::optional<ProfileFunctionScope> in a parallel array indexed
+// Stored in std::optional<ProfileFunctionScope> in a parallel vector indexed
 // by frame depth. Explicit .reset() at Op::RETURN triggers the destructor.
 // ---------------------------------------------------------------------------
 
@@ -224,7 +309,7 @@ class ProfileFunctionScope {
                          int frameDepth, ObjClosure* parentClosure)
         : m_data(&data), m_fn(closure->function),
           m_parentFn(parentClosure ? parentClosure->function : nullptr),
-          m_depth(frameDepth) {
+          m_depth(frameDepth), m_enterNs(data.nowNs()) {
         FunctionStats& s = data.funcTable[m_fn];
         if (s.name.empty()) {
             if (m_fn->name)
@@ -234,13 +319,12 @@ class ProfileFunctionScope {
                 s.name = "<script>";
         }
         s.callCount++;
-        data.frameEnterNs[frameDepth] = data.nowNs();
     }
 
     ~ProfileFunctionScope() {
         if (!m_data)
             return; // moved-from guard
-        int64_t elapsed = m_data->nowNs() - m_data->frameEnterNs[m_depth];
+        int64_t elapsed = m_data->nowNs() - m_enterNs;
         FunctionStats& callee = m_data->funcTable[m_fn];
         callee.totalNs += elapsed;
         callee.selfNs += elapsed;
@@ -255,7 +339,7 @@ class ProfileFunctionScope {
 
     ProfileFunctionScope(ProfileFunctionScope&& o) noexcept
         : m_data(o.m_data), m_fn(o.m_fn), m_parentFn(o.m_parentFn),
-          m_depth(o.m_depth) {
+          m_depth(o.m_depth), m_enterNs(o.m_enterNs) {
         o.m_data = nullptr; // mark moved-from so dtor is a no-op
     }
 
@@ -264,6 +348,7 @@ class ProfileFunctionScope {
     ObjFunction* m_fn;
     ObjFunction* m_parentFn; // nullptr for top-level <script>
     int m_depth;
+    int64_t m_enterNs; // entry timestamp
 };
 
 // ---------------------------------------------------------------------------
@@ -322,7 +407,7 @@ inline void ProfilerData::report(std::FILE* out) const {
     // --- Opcode Dispatch Counts ---
     std::fprintf(out,
                  "--- Opcode Dispatch Counts (non-zero, descending) ---\n");
-    std::fprintf(out, "  %-20s  %14s  %10s\n", "Opcode", "Count", "% of Total");
+    std::fprintf(out, "  %-22s  %14s  %10s\n", "Opcode", "Count", "% of Total");
 
     // Build sorted list of (count, index) pairs.
     struct OpcodeEntry {
@@ -331,7 +416,7 @@ inline void ProfilerData::report(std::FILE* out) const {
     };
     std::vector<OpcodeEntry> entries;
     uint64_t totalOps = 0;
-    for (int i = 0; i < 64; ++i) {
+    for (int i = 0; i < kOpcodeSlots; ++i) {
         if (opcodeTable[i].count > 0) {
             entries.push_back({opcodeTable[i].count, i});
             totalOps += opcodeTable[i].count;
@@ -345,12 +430,81 @@ inline void ProfilerData::report(std::FILE* out) const {
         double pct = totalOps > 0 ? 100.0 * static_cast<double>(e.count) /
                                         static_cast<double>(totalOps)
                                   : 0.0;
-        std::fprintf(out, "  %-20s  %14llu  %9.2f %%\n",
+        std::fprintf(out, "  %-22s  %14llu  %9.2f %%\n",
                      opcodeName(static_cast<Op>(e.index)),
                      static_cast<unsigned long long>(e.count), pct);
     }
     std::fprintf(out, "\n");
 
+    // --- Hot Opcode Pairs ---
+    std::fprintf(out, "--- Hot Opcode Pairs (top 16) ---\n");
+    std::fprintf(out, "  %-34s  %14s  %10s\n", "Pair", "Count", "% of Total");
+    struct PairEntry {
+        uint64_t count;
+        int prev;
+        int next;
+    };
+    std::vector<PairEntry> pairs;
+    for (int prev = 0; prev < kOpcodeSlots; ++prev) {
+        for (int next = 0; next < kOpcodeSlots; ++next) {
+            uint64_t n = pairTable[(prev * kOpcodeSlots) + next];
+            if (n > 0)
+                pairs.push_back({n, prev, next});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(),
+              [](const PairEntry& a, const PairEntry& b) {
+                  return a.count > b.count;
+              });
+    if (pairs.size() > 16)
+        pairs.resize(16);
+    for (const auto& p : pairs) {
+        std::string label = std::string(opcodeName(static_cast<Op>(p.prev))) +
+                            " -> " + opcodeName(static_cast<Op>(p.next));
+        double pct = totalOps > 0 ? 100.0 * static_cast<double>(p.count) /
+                                        static_cast<double>(totalOps)
+                                  : 0.0;
+        std::fprintf(out, "  %-34s  %14llu  %9.2f %%\n", label.c_str(),
+                     static_cast<unsigned long long>(p.count), pct);
+    }
+    std::fprintf(out, "\n");
+
+    // --- Inline Caches ---
+    if (!inlineCaches.empty()) {
+        std::fprintf(out, "--- Inline Caches (top 16 sites by lookups) ---\n");
+        std::fprintf(out, "  %-24s  %-12s  %-16s  %12s  %12s  %s\n", "Site",
+                     "Opcode", "Name", "Hits", "Misses", "State");
+        std::vector<const InlineCacheStats*> sites;
+        for (const auto& site : inlineCaches)
+            sites.push_back(&site);
+        std::sort(sites.begin(), sites.end(),
+                  [](const InlineCacheStats* a, const InlineCacheStats* b) {
+                      return a->hits + a->misses > b->hits + b->misses;
+                  });
+        if (sites.size() > 16)
+            sites.resize(16);
+        for (const InlineCacheStats* site : sites) {
+            std::string where =
+                site->function + ":" + std::to_string(site->line);
+            std::string state;
+            if (site->megamorphic)
+                state = "megamorphic";
+            else if (site->entries == 0)
+                state = "empty";
+            else if (site->entries == 1)
+                state = "monomorphic";
+            else
+                state = "polymorphic(" + std::to_string(site->entries) + ")";
+            std::fprintf(out, "  %-24s  %-12s  %-16s  %12llu  %12llu  %s\n",
+                         where.c_str(), opcodeName(site->op),
+                         site->property.c_str(),
+                         static_cast<unsigned long long>(site->hits),
+                         static_cast<unsigned long long>(site->misses),
+                         state.c_str());
+        }
+        std::fprintf(out, "\n");
+    }
+
     // --- Function Call Profile ---
     std::fprintf(out,
                  "--- Function Call Profile (by total inclusive time) ---\n");
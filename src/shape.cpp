@@ -0,0 +1,22 @@
+#include "shape.h"
+
+ShapeTree::ShapeTree() {
+    m_shapes.push_back(std::make_unique<Shape>());
+    m_root = m_shapes.back().get();
+}
+
+Shape* ShapeTree::transition(Shape* from, ObjString* key) {
+    for (const auto& [edge, to] : from->transitions) {
+        if (edge == key) {
+            return to;
+        }
+    }
+    auto shape = std::make_unique<Shape>();
+    shape->keys.reserve(from->keys.size() + 1);
+    shape->keys.assign(from->keys.begin(), from->keys.end());
+    shape->keys.push_back(key);
+    Shape* to = shape.get();
+    m_shapes.push_back(std::move(shape));
+    from->transitions.emplace_back(key, to);
+    return to;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "object.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Hidden class: the field layout shared by every ObjInstance that gained the
+// same fields in the same order. keys[i] is the name of the field stored in
+// slot i of the instance. Shapes form a tree rooted at the empty layout;
+// adding a field follows (or creates) the transition edge labelled with its
+// name, so instances built by the same constructor share one shape chain.
+struct Shape {
+    std::vector<ObjString*> keys;
+    std::vector<std::pair<ObjString*, Shape*>> transitions;
+
+    [[nodiscard]] uint32_t slotCount() const {
+        return static_cast<uint32_t>(keys.size());
+    }
+
+    // Slot of `key` in this layout, or -1 if instances of this shape have no
+    // such field.
+    [[nodiscard]] int slotOf(const ObjString* key) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+};
+
+// Owns every Shape of one MemoryManager. Shapes are never freed: the tree only
+// grows with the distinct field-insertion orders a program uses, and their
+// keys are GC roots (MemoryManager::collectGarbage marks them).
+class ShapeTree {
+  public:
+    ShapeTree();
+
+    [[nodiscard]] Shape* root() const { return m_root; }
+
+    // The layout reached from `from` by adding field `key`.
+    Shape* transition(Shape* from, ObjString* key);
+
+    // Visits every field name in the tree (some more than once): each key is
+    // the last key of the shape its transition created.
+    template <typename F>
+    void forEachKey(F&& f) const {
+        for (const auto& shape : m_shapes) {
+            if (!shape->keys.empty()) {
+                f(shape->keys.back());
+            }
+        }
+    }
+
+  private:
+    std::vector<std::unique_ptr<Shape>> m_shapes;
+    Shape* m_root;
+};
@@ -119,6 +119,7 @@ static Value fileWriteNative(int /*argc*/, Value* args) {
         return from<Nil>(Nil{});
     }
     auto* s = asObjString(as<Obj*>(args[0]));
+    getActiveMM()->flatten(s);
     std::fwrite(s->chars.data(), 1, s->chars.size(), file->handle);
     return from<Nil>(Nil{});
 }
@@ -137,6 +138,7 @@ static Value fileWritelineNative(int /*argc*/, Value* args) {
         return from<Nil>(Nil{});
     }
     auto* s = asObjString(as<Obj*>(args[0]));
+    getActiveMM()->flatten(s);
     std::fwrite(s->chars.data(), 1, s->chars.size(), file->handle);
     std::fputc('\n', file->handle);
     return from<Nil>(Nil{});
@@ -159,7 +161,8 @@ static Value openNative(int /*argc*/, Value* args) {
     }
     auto* pathStr = asObjString(as<Obj*>(args[0]));
     auto* modeStr = asObjString(as<Obj*>(args[1]));
-    std::string modeS(modeStr->chars.data(), modeStr->chars.size());
+    std::string modeS;
+    modeStr->appendTo(modeS);
 
     bool readable = false, writable = false;
     const char* cmode = nullptr;
@@ -180,7 +183,8 @@ static Value openNative(int /*argc*/, Value* args) {
             "open(): invalid mode. Expected \"r\", \"w\", \"a\", or \"r+\".");
         return from<Nil>(Nil{});
     }
-    std::string pathS(pathStr->chars.data(), pathStr->chars.size());
+    std::string pathS;
+    pathStr->appendTo(pathS);
     FILE* fp = std::fopen(pathS.c_str(), cmode);
     if (!fp) {
         std::string msg = "open(): cannot open '";
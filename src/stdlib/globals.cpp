@@ -4,6 +4,7 @@
 #include "../object.h"
 #include "../value.h"
 
+#include <cmath>
 #include <ctime>
 #include <iostream>
 #include <string>
@@ -23,6 +24,23 @@ static Value inputNative(int /*argCount*/, Value* /*args*/) {
 }
 
 static Value strNative(int /*argCount*/, Value* args) {
+    if (isString(args[0])) {
+        return args[0];
+    }
+    if (isInt(args[0])) {
+        int32_t i = asInt(args[0]);
+        if (i >= 0 && i < MemoryManager::kSmallIntStrings) {
+            return Value{
+                static_cast<Obj*>(getActiveMM()->smallIntString(i))};
+        }
+    } else if (is<Number>(args[0])) {
+        Number n = as<Number>(args[0]);
+        if (n >= 0 && n < MemoryManager::kSmallIntStrings &&
+            n == std::floor(n) && !std::signbit(n)) {
+            return Value{static_cast<Obj*>(
+                getActiveMM()->smallIntString(static_cast<int>(n)))};
+        }
+    }
     std::string s = stringify(args[0]);
     ObjString* obj = getActiveMM()->makeString(s);
     return Value{static_cast<Obj*>(obj)};
@@ -31,15 +49,15 @@ static Value strNative(int /*argCount*/, Value* args) {
 static Value lenNative(int /*argCount*/, Value* args) {
     if (isList(args[0])) {
         auto* list = asObjList(as<Obj*>(args[0]));
-        return from<Number>(static_cast<double>(list->elements.size()));
+        return fromInteger(static_cast<int64_t>(list->elements.size()));
     }
     if (isString(args[0])) {
         auto* s = asObjString(as<Obj*>(args[0]));
-        return from<Number>(static_cast<double>(s->chars.size()));
+        return fromInteger(s->length);
     }
     if (isMap(args[0])) {
         auto* map = asObjMap(as<Obj*>(args[0]));
-        return from<Number>(static_cast<double>(map->map.count()));
+        return fromInteger(map->map.count());
     }
     nativeRuntimeError("len() argument must be a list, string, or map.");
     return from<Nil>(Nil{});
@@ -39,7 +39,8 @@ static bool asPathString(const Value& v, std::string& out) {
         return false;
     }
     auto* s = asObjString(as<Obj*>(v));
-    out.assign(s->chars.data(), s->chars.size());
+    out.clear();
+    s->appendTo(out);
     return true;
 }
 
@@ -6,7 +6,7 @@ void StdlibRegistrar::defineGlobal(const char* name, NativeFn fn, int arity) {
     m_mm.pushTempRoot(native);
     ObjString* key = m_mm.makeString(name);
     m_mm.pushTempRoot(key);
-    m_globals.set(key, Value{static_cast<Obj*>(native)});
+    m_globals.define(key, Value{static_cast<Obj*>(native)});
     m_mm.popTempRoot(); // key
     m_mm.popTempRoot(); // native
 }
@@ -17,7 +17,7 @@ void StdlibRegistrar::defineGlobalValue(const char* name, Value val) {
     }
     ObjString* key = m_mm.makeString(name);
     m_mm.pushTempRoot(key);
-    m_globals.set(key, val);
+    m_globals.define(key, val);
     m_mm.popTempRoot(); // key
     if (is<Obj*>(val)) {
         m_mm.popTempRoot(); // val
@@ -48,8 +48,7 @@ void StdlibRegistrar::addMethod(ObjClass* klass, const char* name, NativeFn fn,
 
 ObjInstance* StdlibRegistrar::makeInstance(ObjClass* klass) {
     m_mm.pushTempRoot(klass);
-    ObjInstance* inst =
-        m_mm.create<ObjInstance>(klass, VmAllocator<Entry>{&m_mm});
+    ObjInstance* inst = m_mm.createInstance(klass);
     m_mm.popTempRoot(); // klass
     return inst;
 }
@@ -61,7 +60,7 @@ void StdlibRegistrar::addField(ObjInstance* inst, const char* name, Value val) {
     }
     ObjString* key = m_mm.makeString(name);
     m_mm.pushTempRoot(key);
-    inst->fields.set(key, val);
+    inst->setField(key, val, m_mm);
     m_mm.popTempRoot(); // key
     if (is<Obj*>(val)) {
         m_mm.popTempRoot(); // val
@@ -76,7 +75,7 @@ void StdlibRegistrar::addNativeField(ObjInstance* inst, const char* name,
     m_mm.pushTempRoot(native);
     ObjString* key = m_mm.makeString(name);
     m_mm.pushTempRoot(key);
-    inst->fields.set(key, Value{static_cast<Obj*>(native)});
+    inst->setField(key, Value{static_cast<Obj*>(native)}, m_mm);
     m_mm.popTempRoot(); // key
     m_mm.popTempRoot(); // native
     m_mm.popTempRoot(); // inst
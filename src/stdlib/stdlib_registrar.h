@@ -1,11 +1,12 @@
 #pragma once
+#include "../global_slots.h"
 #include "../objects.h"
 #include "../table.h"
 #include "../memory_manager.h"
 
 class StdlibRegistrar {
   public:
-    StdlibRegistrar(MemoryManager& mm, Table& globals)
+    StdlibRegistrar(MemoryManager& mm, GlobalSlots& globals)
         : m_mm(mm), m_globals(globals) {}
 
     void defineGlobal(const char* name, NativeFn fn, int arity);
@@ -20,5 +21,5 @@ class StdlibRegistrar {
 
   private:
     MemoryManager& m_mm;
-    Table& m_globals;
+    GlobalSlots& m_globals;
 };
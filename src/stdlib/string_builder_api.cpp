@@ -0,0 +1,60 @@
+#include "string_builder_api.h"
+#include "stdlib_context.h"
+#include "../container_objects.h"
+#include "../vm_allocator.h"
+#include "../value.h"
+
+#include <string>
+#include <string_view>
+
+// Module-local class pointer used by stringBuilderNative to stamp new
+// ObjStringBuilder instances.
+static ObjClass* s_builderClass = nullptr;
+
+// args[-1] = the ObjStringBuilder receiver
+static ObjStringBuilder* checkBuilder(Value* args) {
+    return asObjStringBuilder(as<Obj*>(args[-1]));
+}
+
+// Appends the argument's str() form and returns the builder, so calls chain.
+// The receiver and the argument stay on the VM stack, rooting both while
+// chars grows.
+static Value builderAppendNative(int /*argc*/, Value* args) {
+    ObjStringBuilder* builder = checkBuilder(args);
+    if (isString(args[0])) {
+        auto* s = asObjString(as<Obj*>(args[0]));
+        getActiveMM()->flatten(s);
+        builder->chars.append(s->chars.data(), s->chars.size());
+    } else {
+        std::string s = stringify(args[0]);
+        builder->chars.append(s.data(), s.size());
+    }
+    return args[-1];
+}
+
+static Value builderBuildNative(int /*argc*/, Value* args) {
+    ObjStringBuilder* builder = checkBuilder(args);
+    std::string_view text{builder->chars.data(), builder->chars.size()};
+    return Value{static_cast<Obj*>(getActiveMM()->makeString(text))};
+}
+
+static Value stringBuilderNative(int /*argc*/, Value* /*args*/) {
+    MemoryManager* mm = getActiveMM();
+    ObjStringBuilder* builder =
+        mm->create<ObjStringBuilder>(s_builderClass, VmAllocator<char>{mm});
+    return Value{static_cast<Obj*>(builder)};
+}
+
+ObjClass* registerStringBuilderAPI(StdlibRegistrar& reg) {
+    ObjClass* klass = reg.makeClass("StringBuilder");
+    reg.mm().pushTempRoot(klass);
+
+    reg.addMethod(klass, "append", builderAppendNative, 1);
+    reg.addMethod(klass, "build", builderBuildNative, 0);
+
+    s_builderClass = klass;
+    reg.defineGlobal("StringBuilder", stringBuilderNative, 0);
+
+    reg.mm().popTempRoot(); // klass
+    return klass;
+}
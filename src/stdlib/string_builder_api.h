@@ -0,0 +1,3 @@
+#pragma once
+#include "stdlib_registrar.h"
+ObjClass* registerStringBuilderAPI(StdlibRegistrar& reg);
@@ -15,6 +15,10 @@ bool operator!(Value value) {
 bool operator==(const Value& a, const Value& b) {
     // Numbers must compare as IEEE 754 doubles (so +0.0 == -0.0 and NaN != NaN)
     // rather than by raw representation — handle them before anything else.
+    // Two int-tagged numbers compare without widening.
+    if (isInt(a) && isInt(b)) {
+        return asInt(a) == asInt(b);
+    }
     if (is<Number>(a) && is<Number>(b)) {
         return as<Number>(a) == as<Number>(b);
     }
@@ -27,10 +31,16 @@ bool operator==(const Value& a, const Value& b) {
     if (is<Nil>(a) && is<Nil>(b)) {
         return true;
     }
-    // For strings, interning guarantees same content → same pointer. Other Obj
-    // types use identity equality.
+    // For interned strings, same content → same pointer; ropes compare by
+    // content (see stringsEqual). Other Obj types use identity equality.
     if (is<Obj*>(a) && is<Obj*>(b)) {
-        return as<Obj*>(a) == as<Obj*>(b);
+        Obj* x = as<Obj*>(a);
+        Obj* y = as<Obj*>(b);
+        if (x == y) {
+            return true;
+        }
+        return x->type == ObjType::STRING && y->type == ObjType::STRING &&
+               stringsEqual(asObjString(x), asObjString(y));
     }
     return false;
 }
@@ -70,7 +80,7 @@ uint32_t hashValue(const Value& v) {
         return 0U;
     }
     if (is<Obj*>(v)) {
-        return static_cast<ObjString*>(as<Obj*>(v))->hash;
+        return static_cast<ObjString*>(as<Obj*>(v))->hashCode();
     }
     Number n = as<Number>(v);
     if (n == 0.0) {
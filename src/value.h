@@ -2,7 +2,9 @@
 
 #include "object.h"
 
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <vector>
 
 using Number = double;
@@ -18,10 +20,17 @@ using Number = double;
 // bit (bit 51) set; we additionally require bit 50, so QNAN = 0x7FFC...0000.
 // This keeps a CPU-generated arithmetic NaN (0x7FF8...0000, bit 50 clear) out
 // of our sentinel space, so it still classifies as a Number.
+//
+// An integer-valued Number in int32 range may instead carry INT_TAG (top 16
+// bits 0x7FF9: a quiet NaN with bit 50 clear, so outside the sentinel space,
+// and with a nonzero payload no arithmetic produces) with the int32 in the low
+// 32 bits; see "Small integers" below. Because INT_TAG lies outside QNAN,
+// is<Number> stays the single mask test.
 namespace detail {
 inline constexpr uint64_t QNAN = 0x7FFC000000000000ULL;
 inline constexpr uint64_t SIGN_BIT = 0x8000000000000000ULL;
 inline constexpr uint64_t OBJ_TAG = QNAN | SIGN_BIT; // 0xFFFC000000000000
+inline constexpr uint64_t INT_TAG = 0x7FF9000000000000ULL;
 inline constexpr uint64_t VAL_NIL = QNAN | 0x01ULL;
 inline constexpr uint64_t VAL_FALSE = QNAN | 0x02ULL;
 inline constexpr uint64_t VAL_TRUE = QNAN | 0x03ULL;
@@ -52,6 +61,18 @@ static_assert(sizeof(double) == 8, "Platform must have 64-bit double");
 static_assert(sizeof(uint64_t) == 8, "Platform must have 64-bit uint64_t");
 static_assert(sizeof(Value) == 8, "NaN-boxed Value must be 8 bytes");
 
+inline bool isInt(const Value& v) {
+    return (v.bits >> 48) == (detail::INT_TAG >> 48);
+}
+inline int32_t asInt(const Value& v) {
+    return static_cast<int32_t>(static_cast<uint32_t>(v.bits));
+}
+inline Value fromInt(int32_t i) {
+    Value v;
+    v.bits = detail::INT_TAG | static_cast<uint32_t>(i);
+    return v;
+}
+
 template <typename T>
 bool is(const Value& v);
 template <>
@@ -77,7 +98,8 @@ template <typename T>
 T as(const Value& v);
 template <>
 inline Number as<Number>(const Value& v) {
-    return std::bit_cast<double>(v.bits);
+    return isInt(v) ? static_cast<double>(asInt(v))
+                    : std::bit_cast<double>(v.bits);
 }
 template <>
 inline bool as<bool>(const Value& v) {
@@ -136,8 +158,122 @@ Value from(const T& val) {
     return Value(val);
 }
 
+// No int32 tag in this representation: every Number is a double.
+inline bool isInt(const Value&) { return false; }
+inline int32_t asInt(const Value& v) {
+    return static_cast<int32_t>(std::get<Number>(v));
+}
+inline Value fromInt(int32_t i) { return Value(static_cast<Number>(i)); }
+
 #endif // LOXPP_NAN_TAGGING
 
+// ---- Small integers --------------------------------------------------------
+// Integer-valued Numbers made by literals, lengths and integer arithmetic
+// carry the int32 tag when LOXPP_NAN_TAGGING is on, so loop counters and
+// indices never round-trip through double. A tagged int is still a Number:
+// is<Number> accepts it and as<Number> widens it, so equality, hashValue,
+// stringify and map keys see exactly the double they always did. The helpers
+// below keep results in the int domain while they are exact and fall back to
+// the double operation otherwise (overflow, -0, inexact division).
+
+inline Value fromInteger(int64_t n) {
+    if (static_cast<int32_t>(n) == n) {
+        return fromInt(static_cast<int32_t>(n));
+    }
+    return from<Number>(static_cast<double>(n));
+}
+
+// A Number for d, tagged if d is an int32 other than -0.
+inline Value numberValue(double d) {
+    if (d >= std::numeric_limits<int32_t>::min() &&
+        d <= std::numeric_limits<int32_t>::max()) {
+        auto i = static_cast<int32_t>(d);
+        if (static_cast<double>(i) == d && !(i == 0 && std::signbit(d))) {
+            return fromInt(i);
+        }
+    }
+    return from<Number>(d);
+}
+
+// Operands of these must both satisfy is<Number>.
+inline Value addNumbers(const Value& a, const Value& b) {
+    if (isInt(a) && isInt(b)) {
+        return fromInteger(int64_t{asInt(a)} + asInt(b));
+    }
+    return from<Number>(as<Number>(a) + as<Number>(b));
+}
+
+inline Value subtractNumbers(const Value& a, const Value& b) {
+    if (isInt(a) && isInt(b)) {
+        return fromInteger(int64_t{asInt(a)} - asInt(b));
+    }
+    return from<Number>(as<Number>(a) - as<Number>(b));
+}
+
+inline Value multiplyNumbers(const Value& a, const Value& b) {
+    if (isInt(a) && isInt(b)) {
+        int64_t r = int64_t{asInt(a)} * asInt(b);
+        if (r != 0 || (asInt(a) >= 0 && asInt(b) >= 0)) { // else -0
+            return fromInteger(r);
+        }
+    }
+    return from<Number>(as<Number>(a) * as<Number>(b));
+}
+
+inline Value divideNumbers(const Value& a, const Value& b) {
+    if (isInt(a) && isInt(b)) {
+        int64_t x = asInt(a);
+        int64_t y = asInt(b);
+        if (y != 0 && x % y == 0 && !(x == 0 && y < 0)) {
+            return fromInteger(x / y);
+        }
+    }
+    return from<Number>(as<Number>(a) / as<Number>(b));
+}
+
+// Floored modulo: the result has the sign of b (Python/Lua behaviour).
+inline Value moduloNumbers(const Value& a, const Value& b) {
+    if (isInt(a) && isInt(b) && asInt(b) != 0) {
+        int64_t x = asInt(a);
+        int64_t y = asInt(b);
+        int64_t r = x % y;
+        if (r != 0 && (r < 0) != (y < 0)) {
+            r += y;
+        }
+        if (r != 0 || x >= 0) { // fmod gives -0 for a negative x
+            return fromInteger(r);
+        }
+    }
+    Number y = as<Number>(b);
+    Number result = std::fmod(as<Number>(a), y);
+    if (result != 0 && (result < 0) != (y < 0)) {
+        result += y;
+    }
+    return from<Number>(result);
+}
+
+inline Value negateNumber(const Value& a) {
+    if (isInt(a) && asInt(a) != 0 &&
+        asInt(a) != std::numeric_limits<int32_t>::min()) {
+        return fromInt(-asInt(a));
+    }
+    return from<Number>(-as<Number>(a));
+}
+
+inline bool lessNumbers(const Value& a, const Value& b) {
+    if (isInt(a) && isInt(b)) {
+        return asInt(a) < asInt(b);
+    }
+    return as<Number>(a) < as<Number>(b);
+}
+
+inline bool greaterNumbers(const Value& a, const Value& b) {
+    if (isInt(a) && isInt(b)) {
+        return asInt(a) > asInt(b);
+    }
+    return as<Number>(a) > as<Number>(b);
+}
+
 template <ObjType T>
 inline bool isValueOfType(const Value& v) {
     return is<Obj*>(v) && as<Obj*>(v)->type == T;
@@ -170,8 +306,9 @@ bool isValidMapKey(const Value& v);
 
 // General-purpose hash for any Value, consistent with operator==. Unlike
 // hashValue() (the table's uint32 string-key hash), this hashes Obj* by
-// pointer identity — matching operator== — so it is safe for any value,
-// including non-string objects. Used to dedup the compiler's constant pool.
+// pointer identity — matching operator== for every object but ropes, which
+// never reach the constant pool — so it is safe for any value, including
+// non-string objects. Used to dedup the compiler's constant pool.
 // Implemented via is<T>/as<T>, so it carries over to the NaN-tagged Value
 // representation unchanged.
 struct ValueHash {
@@ -186,6 +323,9 @@ class ValueArray {
     [[nodiscard]] uint16_t size() const;
     [[nodiscard]] bool isFull() const { return m_count >= UINT16_MAX; }
     [[nodiscard]] Value at(uint16_t idx) const { return m_values.at(idx); }
+    // Unchecked view of the pool for the interpreter's hot path; the
+    // compiler guarantees every CONSTANT operand is in range.
+    [[nodiscard]] const Value* data() const { return m_values.data(); }
 
   private:
     std::vector<Value> m_values;
@@ -2,6 +2,8 @@
 
 #include "exec_objects.h"
 #include "class_objects.h"
+#include "container_objects.h"
+#include "global_slots.h"
 #include "memory_manager.h"
 #include "table.h"
 #include "stdlib/stdlib_context.h"
@@ -12,6 +14,7 @@
 #include "profiler.h"
 #endif
 
+#include <array>
 #include <memory>
 #include <optional>
 #include <string>
@@ -24,15 +27,23 @@ enum class InterpretResult : std::uint8_t {
 };
 
 struct CallFrame {
+    int tailCalls; // frames this one has replaced (Op::TAIL_CALL), for traces
     ObjClosure* closure;
-    Chunk::const_iterator ip;
+    Byte* ip; // mutable: VM::run quickens opcodes in place
     Value* slots; // points into the VM stack at this frame's base slot
 };
 
 class VM {
   public:
-    static constexpr int STACK_MAX = 2048;
-    static constexpr int FRAMES_MAX = 256;
+    // The value stack and the frame array start in fixed buffers inside the
+    // VM and move to the heap when a program outgrows them. The value stack
+    // is one contiguous buffer, so moving it moves every frame's `slots`
+    // and every open upvalue (see growStack). Calls nest at most
+    // setMaxStackDepth() frames deep, the script's included; one more is a
+    // "Stack overflow." runtime error.
+    static constexpr int kInitialStackSlots = 2048;
+    static constexpr int kInitialFrames = 256;
+    static constexpr int kDefaultMaxFrames = 10000;
 
     VM() : m_globals(VmAllocator<Entry>{&m_mm}) {
         resetStack();
@@ -48,53 +59,97 @@ class VM {
 
     // Runtime state inspection (for testing and debugging).
     [[nodiscard]] int stackDepth() const {
-        return static_cast<int>(stackTop - stack);
+        return static_cast<int>(stackTop - m_stack);
     }
     [[nodiscard]] int frameCount() const { return m_frameCount; }
     [[nodiscard]] std::optional<Value> getGlobal(const std::string& name) const;
 
+    // Sets the call-depth limit (`loxpp --max-stack`). Only call it between
+    // runs, while no frame is live.
+    void setMaxStackDepth(int frames);
+
     // Sets the command-line arguments exposed to the program via args().
     void setArgs(std::vector<std::string> args) {
         m_stdlibCtx.args = std::move(args);
     }
 
   private:
-    Byte readByte();
-    uint16_t readShort();
-    Value readConstant();
     void resetStack();
     void push(Value value);
     Value pop();
     Value peek(int distance);
 
-    bool call(ObjClosure* closure, int argCount);
+    CallFrame* call(ObjClosure* closure, int argCount);
+    bool tailCall(ObjClosure* closure, int argCount);
+    bool growFrames();
+    int frameBufferSize() const;
+    void growStack(const Value* neededTop);
     bool callNative(ObjNative* native, int argCount);
     bool bindMethod(ObjClass* klass, ObjString* name);
+    void bindMethod(Value method);
+    enum class Property : uint8_t { MISSING, FIELD, METHOD };
+    Property lookupProperty(const Byte* site, ObjClass* klass,
+                            ObjInstance* instance, ObjString* name,
+                            Value& out);
+    Property lookupPropertySlow(InlineCache& ic, ObjClass* klass,
+                                ObjInstance* instance, ObjString* name,
+                                Value& out);
+    void storeField(const Byte* site, ObjInstance* instance, ObjString* name,
+                    Value value);
+    void storeFieldSlow(InlineCache& ic, ObjInstance* instance,
+                        ObjString* name, Value value);
+    InlineCache& inlineCacheAt(const Byte* site, ObjString* name);
+    void inlineCacheMiss(InlineCache& ic, const InlineCache::Entry* refill);
+    // Built-in list methods, dispatched by Op::INVOKE without a method table.
+    // Their names are interned by defineNatives(), so a call site's name
+    // resolves to a method ID by pointer comparison.
+    enum class ListMethod : uint8_t { APPEND, POP, REMOVE, COUNT };
+    ListMethod listMethod(const ObjString* name) const;
+    void recycleIterator(ObjIterator* it);
     void defineNatives();
     ObjUpvalue* captureUpvalue(Value* local);
     void closeUpvalues(Value* last);
     void runtimeError(const char* format, ...);
     void markRoots();
 
-    CallFrame m_frames[FRAMES_MAX];
+    // The initial buffers keep the hot fields of a program that fits in
+    // them at fixed offsets from `this`, next to stackTop.
+    CallFrame m_initialFrames[kInitialFrames];
     int m_frameCount{0};
-    Value stack[STACK_MAX];
+    Value m_initialStack[kInitialStackSlots];
     Value* stackTop;
+    Value* m_stackEnd{m_initialStack + kInitialStackSlots};
+    Value* m_stack{m_initialStack};
+    CallFrame* m_frames{m_initialFrames};
+    int m_frameCapacity{kInitialFrames}; // never above m_maxFrames
+    int m_maxFrames{kDefaultMaxFrames};
+    std::vector<Value> m_grownStack;      // backs m_stack once grown
+    std::vector<CallFrame> m_grownFrames; // backs m_frames once grown
     MemoryManager m_mm;
-    Table m_globals;
+    GlobalSlots m_globals;
     ObjUpvalue* m_openUpvalues{nullptr};
     Value m_lastResult; // For testing/debugging only -- stores the value
                         // popped by Op::POP.
     StdlibContext m_stdlibCtx;
     ObjClass* m_fileClass{nullptr};
     ObjClass* m_mapClass{nullptr};
+    ObjClass* m_builderClass{nullptr};
+    std::array<ObjString*, static_cast<size_t>(ListMethod::COUNT)>
+        m_listMethodNames{};
+    // Iterators of for-in loops that ran to completion (Op::FOR_ITER),
+    // handed out again by GET_ITER so nested loops do not allocate one per
+    // pass. Cleared collections, so they keep nothing else alive.
+    static constexpr int kIteratorPoolSize = 8;
+    std::array<ObjIterator*, kIteratorPoolSize> m_iteratorPool{};
+    int m_iteratorPoolCount{0};
 
 #ifdef LOXPP_PROFILE
     ProfilerData m_profilerData;
     // Parallel to m_frames[]: active ProfileFunctionScope per call depth.
-    // .emplace() at function entry; .reset() at Op::RETURN.
-    std::array<std::optional<ProfileFunctionScope>, FRAMES_MAX>
-        m_profilerScopes;
+    // .emplace() at function entry; .reset() at Op::RETURN. A tail call
+    // does both on the frame it reuses.
+    std::vector<std::optional<ProfileFunctionScope>> m_profilerScopes =
+        std::vector<std::optional<ProfileFunctionScope>>(kInitialFrames);
 
   public:
     const ProfilerData& profilerData() const { return m_profilerData; }
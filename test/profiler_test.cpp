@@ -8,6 +8,9 @@
 //   2. Op::CALL count == Op::RETURN count (balanced for any program).
 //   3. selfNs <= totalNs for every profiled function.
 //   4. GC stats are populated after an allocation-heavy program.
+//   5. Inline-cache sites record one miss per new class, hits otherwise.
+//   6. A tail call that reuses a frame counts as a call of the callee and
+//      closes the scope of the function it replaced.
 
 #include "test_harness.h"
 #include "vm.h"
@@ -133,6 +136,86 @@ TEST_F(ProfilerTest, GcStatsPopulated) {
         << "Expected non-zero bytes freed after GC";
 }
 
+// ---------------------------------------------------------------------------
+// 5. A monomorphic INVOKE site misses once, then hits; a site that sees six
+//    classes ends megamorphic with a miss per lookup after the fifth class.
+// ---------------------------------------------------------------------------
+
+TEST_F(ProfilerTest, InlineCacheHitsAndMisses) {
+    VM vm;
+    const ProfilerData& data = runAndGetProfile(vm, R"(
+        class P { get() { return 1; } }
+        fun mono(p) {
+            var sum = 0;
+            for (var i = 0; i < 10; i = i + 1) sum = sum + p.get();
+            return sum;
+        }
+        mono(P());
+        class A { v() { return 0; } }
+        class B { v() { return 0; } }
+        class C { v() { return 0; } }
+        class D { v() { return 0; } }
+        class E { v() { return 0; } }
+        class F { v() { return 0; } }
+        fun poly(list) {
+            for (var i = 0; i < len(list); i = i + 1) list[i].v();
+        }
+        poly([A(), B(), C(), D(), E(), F(), A(), B()]);
+    )");
+
+    const InlineCacheStats* get = nullptr;
+    const InlineCacheStats* v = nullptr;
+    for (const InlineCacheStats& site : data.inlineCaches) {
+        if (site.property == "get")
+            get = &site;
+        if (site.property == "v")
+            v = &site;
+    }
+    ASSERT_NE(get, nullptr);
+    EXPECT_EQ(get->function, "mono");
+    EXPECT_EQ(get->op, Op::INVOKE);
+    EXPECT_EQ(get->misses, 1u);
+    EXPECT_EQ(get->hits, 9u);
+    EXPECT_EQ(get->entries, 1);
+    EXPECT_FALSE(get->megamorphic);
+
+    ASSERT_NE(v, nullptr);
+    // A-D fill the cache (4 misses), E tips it megamorphic, and from then
+    // on every lookup is a miss: F, A, B.
+    EXPECT_EQ(v->misses, 8u);
+    EXPECT_EQ(v->hits, 0u);
+    EXPECT_TRUE(v->megamorphic);
+}
+
+// ---------------------------------------------------------------------------
+// 6. Tail calls reuse the frame's scope slot.
+// ---------------------------------------------------------------------------
+
+TEST_F(ProfilerTest, TailCallsKeepScopesBalanced) {
+    VM vm;
+    const ProfilerData& data = runAndGetProfile(vm, R"(
+        fun countdown(n) {
+            if (n == 0) return 0;
+            return countdown(n - 1);
+        }
+        countdown(1000);
+    )");
+
+    const FunctionStats* stats = nullptr;
+    for (const auto& [fn, s] : data.funcTable) {
+        if (s.name == "countdown") {
+            stats = &s;
+            break;
+        }
+    }
+    ASSERT_NE(stats, nullptr) << "No profiler entry for 'countdown'";
+    EXPECT_EQ(stats->callCount, 1001u);
+    EXPECT_EQ(vm.frameCount(), 0);
+    for (const auto& [fn, s] : data.funcTable) {
+        EXPECT_LE(s.selfNs, s.totalNs) << s.name;
+    }
+}
+
 #else // LOXPP_PROFILE not defined
 
 // Placeholder so the test binary compiles and reports a clear skip message.
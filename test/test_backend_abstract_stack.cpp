@@ -171,6 +171,35 @@ void checkProbeFile(const fs::path& path) {
     checkReturnHeightZero(tree, path.filename().string());
 }
 
+// ObjFunction::maxStackHeight is the compiler's own running count, and
+// VM::call sizes the value stack by it with no per-push check: it must
+// cover every height this analysis reaches, in every function of the tree.
+void checkMaxStackHeightCovered(const DecodedFunction& fn,
+                                const std::string& path) {
+    FunctionStackAnalysis analysis = analyzeStack(fn);
+    int deepest = 0;
+    for (size_t i = 0; i < fn.instructions.size(); i++) {
+        if (analysis.reached[i]) {
+            deepest = std::max({deepest, analysis.before[i].height,
+                                analysis.after[i].height});
+        }
+    }
+    EXPECT_GE(fn.function->maxStackHeight, deepest) << path;
+    for (const DecodedFunction& child : fn.nested) {
+        checkMaxStackHeightCovered(child, path + " > " + child.displayName);
+    }
+}
+
+void checkMaxStackHeightCovered(const fs::path& path) {
+    SCOPED_TRACE("file=" + path.string());
+    MemoryManager mm;
+    ObjFunction* script =
+        compile(readFile(path), &mm, /*superinstructions=*/true);
+    ASSERT_NE(script, nullptr);
+    checkMaxStackHeightCovered(decodeFunctionTree(script),
+                               path.filename().string());
+}
+
 } // namespace
 
 // Checkpoint 5, directly: analyzeStack must throw on a genuine merge
@@ -384,6 +413,17 @@ TEST(AbstractStackTest, RunsOverBootstrapInterpreterWithNoInconsistency) {
                              "loxpp_interpreter.lox");
 }
 
+TEST(AbstractStackTest, CompilerMaxStackHeightCoversEveryCorpusFunction) {
+    std::vector<fs::path> files =
+        listLoxFiles(projectRoot() / "notes" / "translation-probes");
+    std::vector<fs::path> examples = listLoxFiles(projectRoot() / "examples");
+    files.insert(files.end(), examples.begin(), examples.end());
+    files.push_back(projectRoot() / "bootstrap" / "loxpp_interpreter.lox");
+    for (const fs::path& file : files) {
+        checkMaxStackHeightCovered(file);
+    }
+}
+
 // V1 is the sharpest probe for capture lifetimes (bytecode-translation-
 // problems.md P4): `snapshot` is captured *inside* the loop body, so its
 // declaring push and CLOSE_UPVALUE must both resolve to real slots, not be
@@ -6,9 +6,16 @@
 //   3. Shared upvalue     — two closures share one upvalue (counter pattern).
 //   4. Nested closures    — upvalue-of-upvalue (isLocal=false path).
 //   5. Stack discipline   — stackDepth() == 0 after all closure programs.
+//   6. Early exits        — a captured local closes on break/continue/arm exit.
+//   7. Flattening         — a never-reassigned capture is copied into the
+//                           closure; anything written later stays by reference.
 
+#include "compiler.h"
+#include "memory_manager.h"
 #include "test_harness.h"
 #include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
 
 class ClosureTest : public ::testing::Test {};
 
@@ -266,3 +273,211 @@ TEST_F(ClosureTest, CapturedMatchArmBindingClosesOnArmExit) {
     EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("result1")), 9.0);
     EXPECT_EQ(h.stackDepth(), 0);
 }
+
+TEST_F(ClosureTest, ReassignedLoopVarClosesOnContinue) {
+    // Same shape as CapturedLoopVarClosesOnContinue, but `s` is written after
+    // its declaration, so it is captured by reference and the early exits
+    // must still emit CLOSE_UPVALUE.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun make() {
+            var fns = [nil, nil, nil];
+            for (var i = 0; i < 3; i = i + 1) {
+                var s = 0;
+                s = i;
+                fun f() { return s; }
+                fns[i] = f;
+                if (i == 1) continue;
+                if (i == 2) break;
+            }
+            return fns;
+        }
+        var fs = make();
+        var r0 = fs[0]();
+        var r1 = fs[1]();
+        var r2 = fs[2]();
+    )"),
+              InterpretResult::OK);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("r0")), 0.0);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("r1")), 1.0);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("r2")), 2.0);
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+// ---------------------------------------------------------------------------
+// 7. Flattened captures. The VM's compile (superinstructions on) copies a
+//    capture the source never assigns to into the closure.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+ObjFunction* firstFunctionConstant(ObjFunction* fn) {
+    const Chunk& chunk = fn->chunk;
+    for (uint16_t i = 0; i < chunk.constants().size(); i++) {
+        Value v = chunk.getConstant(i);
+        if (is<Obj*>(v) && isObjType(as<Obj*>(v), ObjType::FUNCTION))
+            return asObjFunction(v);
+    }
+    throw std::runtime_error("No inner function found");
+}
+
+// Disassembles the script's first function, or with `nested` the first
+// function inside that one.
+std::string vmFnBody(const std::string& source, bool nested = false,
+                     bool superinstructions = true) {
+    MemoryManager mm;
+    ObjFunction* script = compile(source, &mm, superinstructions);
+    if (!script)
+        throw std::runtime_error("Compilation failed");
+    ObjFunction* fn = firstFunctionConstant(script);
+    if (nested)
+        fn = firstFunctionConstant(fn);
+    return disassemble_chunk(fn->chunk, mm);
+}
+
+} // namespace
+
+TEST_F(ClosureTest, Flatten_NeverAssignedCaptureIsCopied) {
+    std::string outer = vmFnBody(R"(
+        fun makeMultiplier(factor) {
+            fun multiply(x) { return x * factor; }
+            return multiply;
+        }
+    )");
+    EXPECT_NE(outer.find("local 1 (flat)"), std::string::npos) << outer;
+    EXPECT_EQ(outer.find("CLOSE_UPVALUE"), std::string::npos) << outer;
+    std::string inner = vmFnBody(R"(
+        fun makeMultiplier(factor) {
+            fun multiply(x) { return x * factor; }
+            return multiply;
+        }
+    )",
+                                 /*nested=*/true);
+    EXPECT_NE(inner.find("GET_UPVALUE_FLAT 0"), std::string::npos) << inner;
+}
+
+TEST_F(ClosureTest, Flatten_AssignedCaptureStaysByReference) {
+    std::string inner = vmFnBody(R"(
+        fun make() {
+            var n = 0;
+            fun get() { return n; }
+            n = 5;
+            return get;
+        }
+    )",
+                                 /*nested=*/true);
+    EXPECT_EQ(inner.find("GET_UPVALUE_FLAT"), std::string::npos) << inner;
+    EXPECT_NE(inner.find("GET_UPVALUE 0"), std::string::npos) << inner;
+}
+
+TEST_F(ClosureTest, Flatten_OffWithoutSuperinstructions) {
+    std::string bytecode = vmFnBody(R"(
+        fun makeMultiplier(factor) {
+            fun multiply(x) { return x * factor; }
+            return multiply;
+        }
+    )",
+                                    /*nested=*/true,
+                                    /*superinstructions=*/false);
+    EXPECT_EQ(bytecode.find("GET_UPVALUE_FLAT"), std::string::npos);
+}
+
+TEST_F(ClosureTest, Flatten_PropertyStoreIsNotAnAssignment) {
+    std::string outer = vmFnBody(R"(
+        fun wrap(o, value) {
+            o.value = value;
+            fun get() { return value; }
+            return get;
+        }
+    )");
+    EXPECT_NE(outer.find("local 2 (flat)"), std::string::npos) << outer;
+}
+
+TEST_F(ClosureTest, Flatten_LateAssignmentIsSeen) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun make() {
+            var n = 1;
+            fun get() { return n; }
+            n = 2;
+            return get;
+        }
+        var result = make()();
+    )"),
+              InterpretResult::OK);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("result")), 2.0);
+}
+
+TEST_F(ClosureTest, Flatten_UpvalueOfFlatUpvalue) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun outer(a) {
+            fun middle(b) {
+                fun inner(c) { return a + b + c; }
+                return inner;
+            }
+            return middle;
+        }
+        var result = outer(1)(20)(300);
+    )"),
+              InterpretResult::OK);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("result")), 321.0);
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST_F(ClosureTest, Flatten_RecursiveLocalFunction) {
+    // A local function's slot holds the closure before its captures are
+    // read, so capturing itself by value is sound.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun run() {
+            fun fib(n) {
+                if (n < 2) return n;
+                return fib(n - 1) + fib(n - 2);
+            }
+            return fib;
+        }
+        var result = run()(15);
+    )"),
+              InterpretResult::OK);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("result")), 610.0);
+}
+
+TEST_F(ClosureTest, Flatten_ThisInCallback) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Box {
+            init(v) { this.v = v; }
+            getter() {
+                fun get() { return this.v; }
+                return get;
+            }
+        }
+        var b = Box(4);
+        var g = b.getter();
+        b.v = 8;
+        var result = g();
+    )"),
+              InterpretResult::OK);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("result")), 8.0);
+}
+
+TEST_F(ClosureTest, Flatten_ForInItemStaysByReference) {
+    // The item variable is rewritten by the loop itself, with no `=` in the
+    // source; closures made in the body share its one slot.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun make() {
+            var fns = [];
+            for (var x in [1, 2, 3]) {
+                fun f() { return x; }
+                fns.append(f);
+            }
+            return fns;
+        }
+        var fs = make();
+        var result = fs[0]() + fs[1]() + fs[2]();
+    )"),
+              InterpretResult::OK);
+    EXPECT_DOUBLE_EQ(as<Number>(*h.getGlobal("result")), 9.0);
+}
@@ -80,6 +80,8 @@ class VMTestHarness {
         m_vm.setArgs(std::move(args));
     }
 
+    void setMaxStackDepth(int frames) { m_vm.setMaxStackDepth(frames); }
+
   private:
     VM m_vm;
 };
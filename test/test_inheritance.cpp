@@ -13,6 +13,8 @@
 //   9. Compile error: super in class without superclass.
 //  10. Compile error: self-inheritance.
 //  11. Runtime error: superclass is not a class.
+//  12. Cached initializer — each class constructs with the init() it defines
+//      or inherits, and a class without one still rejects arguments.
 
 #include "test_harness.h"
 #include <gtest/gtest.h>
@@ -206,3 +208,27 @@ TEST_F(InheritanceTest, RuntimeError_SuperclassNotAClass) {
     )"),
               InterpretResult::RUNTIME_ERROR);
 }
+
+// ---------------------------------------------------------------------------
+// 12. Cached initializer: ObjClass::initializer follows DEFINE_METHOD and
+//     INHERIT.
+// ---------------------------------------------------------------------------
+
+TEST_F(InheritanceTest, CachedInitializerPerClass) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Base { init(v) { this.v = v; } }
+        class Keeps < Base {}
+        class Overrides < Base {
+            init() { super.init(10); this.v = this.v + 1; }
+        }
+        class Plain {}
+        var r = str(Base(1).v) + " " + str(Keeps(2).v) + " " +
+                str(Overrides().v) + " " + str(Base(3).v);
+        var p = Plain();
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "1 2 11 3");
+    EXPECT_EQ(run_program("class Plain {} Plain(1);"),
+              InterpretResult::RUNTIME_ERROR);
+}
@@ -0,0 +1,207 @@
+// test_inline_cache.cpp — per-site method caches for GET_PROPERTY / INVOKE.
+//
+// Invariants under test:
+//   1. The compiler gives every property site (GET_PROPERTY, INVOKE,
+//      SET_PROPERTY) its own InlineCache, and nothing else gets one.
+//   2. A site fills up to InlineCache::kEntries classes, then goes megamorphic
+//      and keeps resolving correctly.
+//   3. Caching never changes what a lookup finds: fields still shadow
+//      methods, overrides win per receiver class, and a re-declared class is
+//      a different cache key.
+//
+// Also built as test_inline_cache_gc (LOXPP_STRESS_GC), which checks that the
+// classes and methods held by a cache survive collections.
+
+#include "compiler.h"
+#include "exec_objects.h"
+#include "memory_manager.h"
+#include "test_harness.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+const Chunk& globalChunk(const VMTestHarness& h, const std::string& name) {
+    std::optional<Value> v = h.getGlobal(name);
+    if (!v || !isClosure(*v))
+        throw std::runtime_error("no closure named " + name);
+    return asObjClosure(*v)->function->chunk;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// 1. Allocation
+// ---------------------------------------------------------------------------
+
+TEST(InlineCache, OnePerPropertySite) {
+    MemoryManager mm;
+    ObjFunction* script = compile(R"(
+        fun f(o) {
+            o.a;
+            o.b();
+            o.c = 1;
+            o.a;
+        }
+    )",
+                                  &mm);
+    ASSERT_NE(script, nullptr);
+    // Two GET_PROPERTY sites, one INVOKE and one SET_PROPERTY.
+    EXPECT_EQ(find_inner_function(script)->chunk.inlineCaches().size(), 4u);
+    EXPECT_TRUE(script->chunk.inlineCaches().empty());
+}
+
+// ---------------------------------------------------------------------------
+// 2. Polymorphic and megamorphic sites
+// ---------------------------------------------------------------------------
+
+TEST(InlineCache, PolymorphicSiteCachesEachClass) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class A { name() { return "a"; } }
+        class B { name() { return "b"; } }
+        class C { name() { return "c"; } }
+        fun names(list) {
+            var out = "";
+            for (var i = 0; i < len(list); i = i + 1) out = out + list[i].name();
+            return out;
+        }
+        var r = names([A(), B(), C(), A(), B(), C()]);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "abcabc");
+
+    const InlineCache& ic = globalChunk(h, "names").inlineCaches().at(0);
+    EXPECT_EQ(ic.count, 3);
+    EXPECT_FALSE(ic.megamorphic);
+}
+
+TEST(InlineCache, MegamorphicSiteKeepsResolving) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class A { name() { return "a"; } }
+        class B { name() { return "b"; } }
+        class C { name() { return "c"; } }
+        class D { name() { return "d"; } }
+        class E { name() { return "e"; } }
+        class F { name() { return "f"; } }
+        fun names(list) {
+            var out = "";
+            for (var i = 0; i < len(list); i = i + 1) out = out + list[i].name();
+            return out;
+        }
+        var r = names([A(), B(), C(), D(), E(), F(), A(), F()]);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "abcdefaf");
+
+    const InlineCache& ic = globalChunk(h, "names").inlineCaches().at(0);
+    EXPECT_TRUE(ic.megamorphic);
+    EXPECT_EQ(ic.count, 0);
+}
+
+TEST(InlineCache, BoundMethodThroughGetProperty) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Counter {
+            init() { this.n = 0; }
+            bump() { this.n = this.n + 1; return this.n; }
+        }
+        fun grab(c) { return c.bump; }
+        var c = Counter();
+        var r = 0;
+        for (var i = 0; i < 5; i = i + 1) r = grab(c)();
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "5");
+    EXPECT_EQ(globalChunk(h, "grab").inlineCaches().at(0).count, 1);
+}
+
+// ---------------------------------------------------------------------------
+// 3. Lookup semantics are unchanged
+// ---------------------------------------------------------------------------
+
+TEST(InlineCache, FieldStillShadowsCachedMethod) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class A { m() { return "method"; } }
+        fun call(o) { return o.m(); }
+        fun get(o) { return o.m; }
+        var a = A();
+        var first = call(a);
+        get(a);
+        fun shadow() { return "field"; }
+        a.m = shadow;
+        var second = call(a);
+        var third = get(a)();
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("first"), "method");
+    EXPECT_EQ(h.getGlobalStr("second"), "field");
+    EXPECT_EQ(h.getGlobalStr("third"), "field");
+}
+
+TEST(InlineCache, OverridesResolvePerReceiverClass) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Base {
+            who() { return "base"; }
+            only() { return "inherited"; }
+        }
+        class Derived < Base { who() { return "derived"; } }
+        fun ask(o) { return o.who() + "/" + o.only(); }
+        var r = ask(Base()) + " " + ask(Derived()) + " " + ask(Base());
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"),
+              "base/inherited derived/inherited base/inherited");
+}
+
+TEST(InlineCache, RedeclaredClassIsANewKey) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun call(o) { return o.v(); }
+        class K { v() { return 1; } }
+        var first = call(K());
+        class K { v() { return 2; } }
+        var second = call(K());
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("first"), "1");
+    EXPECT_EQ(h.getGlobalStr("second"), "2");
+}
+
+TEST(InlineCache, MissingMethodIsStillAnError) {
+    VMTestHarness h;
+    EXPECT_EQ(h.run(R"(
+        class A { m() { return 1; } }
+        class B {}
+        fun call(o) { return o.m(); }
+        call(A());
+        call(B());
+    )"),
+              InterpretResult::RUNTIME_ERROR);
+}
+
+TEST(InlineCache, CachedClassesSurviveCollection) {
+    // The only reference to the class object below is the cache entry (and
+    // the instance, until it is dropped); allocation in the loop gives the
+    // stress-GC build plenty of collections in between.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun call(o) { return o.v(); }
+        fun make() {
+            class Temp { v() { return "t"; } }
+            return Temp();
+        }
+        var out = "";
+        for (var i = 0; i < 20; i = i + 1) {
+            out = out + call(make());
+            var garbage = [str(i), str(i + 1)];
+        }
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("out"), "tttttttttttttttttttt");
+}
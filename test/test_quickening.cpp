@@ -0,0 +1,208 @@
+// test_quickening.cpp — in-place type specialization of arithmetic opcodes.
+//
+// VM::run rewrites a generic ADD/SUBTRACT/MULTIPLY/DIVIDE/LESS/GREATER to its
+// quickened form (ADD_NUM, ADD_STR, ...) after executing it once, and back
+// again when a guard fails; an INVOKE of list.append / list.pop likewise
+// becomes INVOKE_LIST_APPEND / INVOKE_LIST_POP. These tests check that:
+//   1. a run leaves the chunk quickened, and compile() never does;
+//   2. a type change deoptimizes the site and still computes the generic
+//      result (or raises the generic runtime error);
+//   3. the decoder still sees the compiler's canonical stream.
+
+#include "backend/chunk_decoder.h"
+#include "compiler.h"
+#include "exec_objects.h"
+#include "memory_manager.h"
+#include "test_harness.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+// The function bound to global `name` after a harness run, as the VM left it.
+ObjFunction* globalFunction(const VMTestHarness& h, const std::string& name) {
+    std::optional<Value> v = h.getGlobal(name);
+    if (!v || !isClosure(*v))
+        throw std::runtime_error("no closure named " + name);
+    return asObjClosure(*v)->function;
+}
+
+std::string disassembleGlobal(const VMTestHarness& h,
+                              const std::string& name) {
+    MemoryManager mm;
+    return disassemble_chunk(globalFunction(h, name)->chunk, mm);
+}
+
+bool contains(const std::string& haystack, const std::string& needle) {
+    return haystack.find(needle) != std::string::npos;
+}
+
+const char* kArithmetic = R"(
+    fun arith(a, b) {
+        var x = a * b;
+        var y = x - a;
+        var z = y / b;
+        var w = z + 1;
+        return w < b or w > a;
+    }
+)";
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// 1. Quickening
+// ---------------------------------------------------------------------------
+
+TEST(Quickening, NumericRunQuickensEverySite) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(std::string(kArithmetic) + "var r = arith(6, 3);"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "false"); // both sides of `or` ran
+
+    std::string bytecode = disassembleGlobal(h, "arith");
+    for (const char* op : {"MULTIPLY_NUM", "SUBTRACT_NUM", "DIVIDE_NUM",
+                           "ADD_NUM", "LESS_NUM", "GREATER_NUM"}) {
+        EXPECT_TRUE(contains(bytecode, op)) << op << " missing in\n"
+                                            << bytecode;
+    }
+}
+
+TEST(Quickening, CompilerNeverEmitsQuickenedOps) {
+    std::string bytecode = compile_fn_body_to_bytecode(kArithmetic);
+    EXPECT_FALSE(contains(bytecode, "_NUM")) << bytecode;
+    EXPECT_TRUE(contains(bytecode, "MULTIPLY\n")) << bytecode;
+}
+
+TEST(Quickening, ErrorDoesNotQuicken) {
+    VMTestHarness h;
+    EXPECT_EQ(h.run(R"(
+        fun sub(a, b) { return a - b; }
+        sub("x", 1);
+    )"),
+              InterpretResult::RUNTIME_ERROR);
+    EXPECT_FALSE(contains(disassembleGlobal(h, "sub"), "SUBTRACT_NUM"));
+}
+
+// ---------------------------------------------------------------------------
+// 2. Deoptimization
+// ---------------------------------------------------------------------------
+
+TEST(Quickening, AddSiteFollowsOperandTypes) {
+    // `[a][0] + b` keeps the ADD out of the ADD_LOCALS superinstruction,
+    // whose fast path would skip it.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun add(a, b) { return [a][0] + b; }
+        var s1 = add("foo", "bar");
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("s1"), "foobar");
+    EXPECT_TRUE(contains(disassembleGlobal(h, "add"), "ADD_STR"));
+
+    ASSERT_EQ(h.run("var n = add(40, 2);"), InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("n"), "42");
+    std::string bytecode = disassembleGlobal(h, "add");
+    EXPECT_TRUE(contains(bytecode, "ADD_NUM")) << bytecode;
+    EXPECT_FALSE(contains(bytecode, "ADD_STR")) << bytecode;
+
+    ASSERT_EQ(h.run("var s2 = add(\"a\", \"b\");"), InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("s2"), "ab");
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST(Quickening, DeoptimizedSiteKeepsRuntimeError) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun less(a, b) { return a < b; }
+        var r = less(1, 2);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "true");
+    EXPECT_TRUE(contains(disassembleGlobal(h, "less"), "LESS_NUM"));
+
+    EXPECT_EQ(h.run("less(\"a\", 2);"), InterpretResult::RUNTIME_ERROR);
+    EXPECT_FALSE(contains(disassembleGlobal(h, "less"), "LESS_NUM"));
+}
+
+TEST(Quickening, PolymorphicLoopComputesGenericResults) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun twice(x) { return [x][0] + x; }
+        var out = "";
+        for (var i = 0; i < 4; i = i + 1) {
+            if (i % 2 == 0) out = out + str(twice(i));
+            else out = out + twice("s");
+        }
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("out"), "0ss4ss");
+}
+
+TEST(Quickening, ListMethodSitesFollowReceiver) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun cycle(xs, v) {
+            xs.append(v);
+            return xs.pop();
+        }
+        var r1 = cycle([1], 2);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r1"), "2");
+    std::string bytecode = disassembleGlobal(h, "cycle");
+    EXPECT_TRUE(contains(bytecode, "INVOKE_LIST_APPEND")) << bytecode;
+    EXPECT_TRUE(contains(bytecode, "INVOKE_LIST_POP")) << bytecode;
+
+    // An instance with its own append/pop takes the sites back to INVOKE.
+    ASSERT_EQ(h.run(R"(
+        class Stack {
+            init() { this.n = 0; }
+            append(v) { this.n = this.n + v; }
+            pop() { return this.n; }
+        }
+        var r2 = cycle(Stack(), 5);
+        var r3 = cycle([], 7);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r2"), "5");
+    EXPECT_EQ(h.getGlobalStr("r3"), "7");
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST(Quickening, QuickenedPopKeepsEmptyListError) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun take(xs) { return xs.pop(); }
+        var r = take([3]);
+    )"),
+              InterpretResult::OK);
+    EXPECT_TRUE(contains(disassembleGlobal(h, "take"), "INVOKE_LIST_POP"));
+    EXPECT_EQ(h.run("take([]);"), InterpretResult::RUNTIME_ERROR);
+}
+
+// ---------------------------------------------------------------------------
+// 3. Decoder sees the canonical stream
+// ---------------------------------------------------------------------------
+
+TEST(Quickening, DecoderCanonicalizesQuickenedChunk) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(std::string(kArithmetic) + "arith(6, 3);"),
+              InterpretResult::OK);
+
+    MemoryManager mm;
+    ObjFunction* script = compile(kArithmetic, &mm);
+    ASSERT_NE(script, nullptr);
+    std::vector<DecodedInstruction> plain =
+        decodeChunk(find_inner_function(script)->chunk);
+    std::vector<DecodedInstruction> quickened =
+        decodeChunk(globalFunction(h, "arith")->chunk);
+
+    ASSERT_EQ(plain.size(), quickened.size());
+    for (size_t i = 0; i < plain.size(); i++) {
+        EXPECT_EQ(plain[i].offset, quickened[i].offset);
+        EXPECT_EQ(plain[i].op, quickened[i].op) << "@" << plain[i].offset;
+        EXPECT_EQ(plain[i].length, quickened[i].length);
+    }
+}
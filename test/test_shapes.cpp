@@ -0,0 +1,265 @@
+// test_shapes.cpp — hidden-class field layout of ObjInstance.
+//
+// Invariants under test:
+//   1. Instances that gain the same fields in the same order share one Shape;
+//      a different order is a different Shape.
+//   2. Fields past an instance's inline slots spill into `overflow`, and the
+//      class's inlineSlotHint grows so later instances keep them inline.
+//   3. Past ObjInstance::kMaxShapeSlots fields an instance switches to
+//      dictionary mode and keeps working: reads, writes, method calls and
+//      field shadowing.
+//   4. Everything that reads fields (destructuring, class patterns, cached
+//      GET_PROPERTY / SET_PROPERTY / INVOKE sites) sees the slot layout.
+//
+// Also built as test_shapes_gc (LOXPP_STRESS_GC), which collects on every
+// allocation — including overflow growth and dictionary conversion midway
+// through a field store.
+
+#include "compiler.h"
+#include "exec_objects.h"
+#include "memory_manager.h"
+#include "test_harness.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+void expect_num(const Value& v, double expected) {
+    ASSERT_TRUE(is<Number>(v)) << "expected Number";
+    EXPECT_NEAR(as<Number>(v), expected, 1e-9);
+}
+
+ObjInstance* globalInstance(const VMTestHarness& h, const std::string& name) {
+    std::optional<Value> v = h.getGlobal(name);
+    if (!v || !isInstance(*v))
+        throw std::runtime_error("no instance named " + name);
+    return asObjInstance(as<Obj*>(*v));
+}
+
+std::string keyAt(const Shape* shape, uint32_t slot) {
+    const ObjString* key = shape->keys.at(slot);
+    return {key->chars.data(), key->chars.size()};
+}
+
+// `class Wide` whose init() sets fields f0 .. f<n-1> to 0 .. n-1.
+std::string wideClass(int n) {
+    std::string src = "class Wide {\n  init() {\n";
+    for (int i = 0; i < n; i++) {
+        src += "    this.f" + std::to_string(i) + " = " + std::to_string(i) +
+               ";\n";
+    }
+    src += "  }\n  sum() { return this.f0 + this.f" + std::to_string(n - 1) +
+           "; }\n}\n";
+    return src;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// 1. Shared transitions
+// ---------------------------------------------------------------------------
+
+TEST(Shapes, SameConstructorSharesShape) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Point { init(x, y) { this.x = x; this.y = y; } }
+        var a = Point(1, 2);
+        var b = Point(3, 4);
+    )"),
+              InterpretResult::OK);
+    ObjInstance* a = globalInstance(h, "a");
+    ObjInstance* b = globalInstance(h, "b");
+    ASSERT_NE(a->shape, nullptr);
+    EXPECT_EQ(a->shape, b->shape);
+    ASSERT_EQ(a->shape->slotCount(), 2u);
+    EXPECT_EQ(keyAt(a->shape, 0), "x");
+    EXPECT_EQ(keyAt(a->shape, 1), "y");
+    expect_num(b->slot(1), 4.0);
+}
+
+TEST(Shapes, InsertionOrderSelectsShape) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Bag {}
+        var a = Bag();
+        a.x = 1;
+        a.y = 2;
+        var b = Bag();
+        b.y = 3;
+        b.x = 4;
+        var c = Bag();
+        c.x = 5;
+        c.x = 6;
+        var r = a.x + a.y + b.x + b.y + c.x;
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "16");
+    ObjInstance* a = globalInstance(h, "a");
+    ObjInstance* b = globalInstance(h, "b");
+    ObjInstance* c = globalInstance(h, "c");
+    EXPECT_NE(a->shape, b->shape);
+    EXPECT_EQ(keyAt(b->shape, 0), "y");
+    // Overwriting a field keeps the shape: c stopped one transition short of a.
+    EXPECT_EQ(c->shape->slotCount(), 1u);
+    EXPECT_EQ(c->shape->transitions.size(), 1u);
+    EXPECT_EQ(c->shape->transitions[0].second, a->shape);
+}
+
+// ---------------------------------------------------------------------------
+// 2. Inline slots and overflow
+// ---------------------------------------------------------------------------
+
+TEST(Shapes, OverflowSlotsAndGrowingHint) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Six {
+            init() {
+                this.a = 1; this.b = 2; this.c = 3;
+                this.d = 4; this.e = 5; this.f = 6;
+            }
+        }
+        var first = Six();
+        var second = Six();
+        var r = first.f * 10 + second.e;
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "65");
+    ObjInstance* first = globalInstance(h, "first");
+    ObjInstance* second = globalInstance(h, "second");
+    EXPECT_EQ(first->shape, second->shape);
+    EXPECT_EQ(first->inlineSlots, 4u);
+    EXPECT_EQ(first->overflow.size(), 2u);
+    EXPECT_EQ(second->inlineSlots, 6u);
+    EXPECT_TRUE(second->overflow.empty());
+    EXPECT_EQ(first->klass->inlineSlotHint, 6u);
+}
+
+// ---------------------------------------------------------------------------
+// 3. Dictionary mode
+// ---------------------------------------------------------------------------
+
+TEST(Shapes, DictionaryModePastMaxShapeSlots) {
+    constexpr int kFields = ObjInstance::kMaxShapeSlots + 8;
+    VMTestHarness h;
+    ASSERT_EQ(h.run(wideClass(kFields) + R"(
+        var w = Wide();
+        var before = w.sum();
+        w.f0 = 100;
+        w.extra = 7;
+        var after = w.sum() + w.extra;
+        fun sum() { return -1; }
+        w.sum = sum;
+        var shadowed = w.sum();
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("before"), std::to_string(kFields - 1));
+    EXPECT_EQ(h.getGlobalStr("after"), std::to_string(100 + kFields - 1 + 7));
+    EXPECT_EQ(h.getGlobalStr("shadowed"), "-1");
+
+    ObjInstance* w = globalInstance(h, "w");
+    EXPECT_EQ(w->shape, nullptr);
+    ASSERT_NE(w->dictionary, nullptr);
+    EXPECT_TRUE(w->overflow.empty());
+    EXPECT_EQ(w->klass->inlineSlotHint, ObjInstance::kMaxInlineSlots);
+    int fields = 0;
+    w->forEachField([&fields](ObjString*, Value) { fields++; });
+    EXPECT_EQ(fields, kFields + 2); // f0 .. f<kFields-1>, extra, sum
+}
+
+// ---------------------------------------------------------------------------
+// 4. Field readers
+// ---------------------------------------------------------------------------
+
+TEST(Shapes, DestructuringReadsSlots) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Point { init(x, y) { this.x = x; this.y = y; } }
+        fun local(p) {
+            var {y, x} = p;
+            return x * 10 + y;
+        }
+        var {x, y} = Point(5, 6);
+        var g = x * 10 + y;
+        var l = local(Point(7, 8));
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("g"), "56");
+    EXPECT_EQ(h.getGlobalStr("l"), "78");
+}
+
+TEST(Shapes, ClassPatternReadsSlotsOfEveryShape) {
+    // The Point pattern sees two layouts, the Wide one a dictionary-mode
+    // instance.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(wideClass(ObjInstance::kMaxShapeSlots + 1) + R"(
+        class Point {}
+        fun describe(p) {
+            return match p {
+                case Point{x, y} => x - y
+                case Wide{f1} => f1
+                case _ => nil
+            };
+        }
+        var a = Point();
+        a.x = 9;
+        a.y = 4;
+        var b = Point();
+        b.y = 1;
+        b.x = 3;
+        var r = str(describe(a)) + " " + str(describe(b)) + " " +
+                str(describe(Wide()));
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "5 2 1");
+}
+
+TEST(Shapes, SetPropertyCachesTransitions) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Node {}
+        fun fill(n, v) {
+            n.value = v;
+            n.next = nil;
+            return n;
+        }
+        var out = 0;
+        for (var i = 0; i < 10; i = i + 1) out = out + fill(Node(), i).value;
+        var again = fill(fill(Node(), 1), 2).value;
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("out"), "45");
+    EXPECT_EQ(h.getGlobalStr("again"), "2");
+
+    std::optional<Value> fill = h.getGlobal("fill");
+    ASSERT_TRUE(fill && isClosure(*fill));
+    const Chunk& chunk = asObjClosure(as<Obj*>(*fill))->function->chunk;
+    // n.value: one entry adding the field to an empty Node, one overwriting
+    // it in place (the second fill() of the same node).
+    const InlineCache& value = chunk.inlineCaches().at(0);
+    ASSERT_EQ(value.count, 2);
+    EXPECT_NE(value.entries[0].transition, nullptr);
+    EXPECT_EQ(value.entries[1].transition, nullptr);
+    EXPECT_EQ(value.entries[1].slot, 0);
+}
+
+TEST(Shapes, FieldsSurviveCollection) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Rec {}
+        var keep = [];
+        for (var i = 0; i < 30; i = i + 1) {
+            var r = Rec();
+            r.a = str(i);
+            r.b = [str(i + 1)];
+            r.c = r.a + "!";
+            r.d = r.b[0];
+            r.e = r.c + r.d;
+            keep.append(r);
+        }
+        var last = keep[29].e;
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("last"), "29!30");
+}
@@ -26,6 +26,26 @@ TEST_F(StressGCTest, StringConcatSurvivesGC) {
     EXPECT_EQ(h.stackDepth(), 0);
 }
 
+TEST_F(StressGCTest, RopeFlattenSurvivesGC) {
+    // Every append past ObjString::kMinRopeLength makes a rope node; indexing
+    // and `in` flatten it, allocating the flat buffer while its children
+    // must stay alive.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        var s = "";
+        for (var i = 0; i < 30; i = i + 1) s = s + "abcdef";
+        var ch = s[175];
+        var found = "fabc" in s;
+        var sb = StringBuilder();
+        sb.append(s).append(1);
+        var built = sb.build();
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("ch"), "b");
+    EXPECT_EQ(h.getGlobalStr("found"), "true");
+    EXPECT_EQ(h.getGlobalStr("built").size(), 181u);
+}
+
 // ---------------------------------------------------------------------------
 // Global function declaration and call
 // ---------------------------------------------------------------------------
@@ -0,0 +1,377 @@
+// test_superinstructions.cpp — peephole fusion of hot opcode runs.
+//
+// Three things must hold for the superinstructions in chunk.h:
+//   1. The peephole pass fuses the runs it targets, and only those (golden
+//      disassembly of a fused chunk).
+//   2. Everything outside the VM still sees the compiler's canonical stream:
+//      decoding a fused chunk yields exactly the instructions of the unfused
+//      one, across the whole example corpus.
+//   3. A guard miss (non-Number operands) executes the run unfused, so
+//      results and runtime errors are unchanged.
+// The same pass marks tail calls (TAIL_CALL, TAIL_INVOKE); their runtime
+// behaviour is covered by test_tail_calls.cpp.
+
+#include "backend/chunk_decoder.h"
+#include "compiler.h"
+#include "memory_manager.h"
+#include "test_harness.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifndef LOXPP_PROJECT_SOURCE_DIR
+#error                                                                         \
+    "LOXPP_PROJECT_SOURCE_DIR must be defined by the build (see test/CMakeLists.txt)"
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string fusedFnBody(const std::string& source, int n = 0) {
+    MemoryManager mm;
+    ObjFunction* script = compile(source, &mm, /*superinstructions=*/true);
+    if (!script)
+        throw std::runtime_error("Compilation failed");
+    return disassemble_chunk(find_inner_function(script, n)->chunk, mm);
+}
+
+void expectSameDecoding(const DecodedFunction& plain,
+                        const DecodedFunction& fused,
+                        const std::string& where) {
+    ASSERT_EQ(plain.instructions.size(), fused.instructions.size()) << where;
+    for (size_t i = 0; i < plain.instructions.size(); i++) {
+        const DecodedInstruction& a = plain.instructions[i];
+        const DecodedInstruction& b = fused.instructions[i];
+        EXPECT_EQ(a.offset, b.offset) << where;
+        // A local captured only by value (GET_UPVALUE_FLAT) leaves nothing
+        // to close, so the VM's compile pops it instead.
+        if (!(a.op == Op::CLOSE_UPVALUE && b.op == Op::POP)) {
+            EXPECT_EQ(a.op, b.op) << where << " @" << a.offset;
+        }
+        EXPECT_EQ(a.length, b.length) << where << " @" << a.offset;
+        EXPECT_EQ(a.constantIndex, b.constantIndex) << where;
+        EXPECT_EQ(a.byteOperand, b.byteOperand) << where;
+        EXPECT_EQ(a.jumpTarget, b.jumpTarget) << where;
+    }
+    ASSERT_EQ(plain.nested.size(), fused.nested.size()) << where;
+    for (size_t i = 0; i < plain.nested.size(); i++) {
+        expectSameDecoding(plain.nested[i], fused.nested[i],
+                           where + "/" + plain.nested[i].displayName);
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// 1. Fusion
+// ---------------------------------------------------------------------------
+
+TEST(Superinstructions, WhileLoopFusesConditionAndIncrement) {
+    std::string bytecode = fusedFnBody(R"(
+        fun count() {
+            var i = 0;
+            while (i < 10) i = i + 1;
+            return i;
+        }
+    )");
+    // Each fused head keeps the length of the run it covers, so the offsets
+    // and the LOOP/jump targets are those of the unfused chunk.
+    std::string expected = "0: CONSTANT 0 ('0')\n"
+                           "3: LESS_LOCAL_CONST_JUMP 1 ('10') 3 -> 25\n"
+                           "13: INCR_LOCAL 1 ('1') 1\n"
+                           "22: LOOP 22 -> 3\n"
+                           "25: POP\n"
+                           "26: GET_LOCAL 1\n"
+                           "28: RETURN\n"
+                           "29: NIL\n"
+                           "30: RETURN\n";
+    EXPECT_EQ(bytecode, expected);
+}
+
+TEST(Superinstructions, ForLoopFusesAddOfLocalsAndConditionalJump) {
+    std::string bytecode = fusedFnBody(R"(
+        fun sum(n) {
+            var total = 0;
+            for (var i = 0; i < n; i = i + 1) {
+                total = total + i;
+            }
+            return total;
+        }
+    )");
+    std::string expected = "0: CONSTANT 0 ('0')\n"
+                           "3: CONSTANT 0 ('0')\n"
+                           "6: GET_LOCAL 3\n"
+                           "8: GET_LOCAL 1\n"
+                           "10: LESS\n"
+                           "11: JUMP_IF_FALSE_POP 11 -> 41\n"
+                           "15: JUMP 15 -> 30\n"
+                           "18: INCR_LOCAL 3 ('1') 3\n"
+                           "27: LOOP 27 -> 6\n"
+                           "30: ADD_LOCALS 2 3\n"
+                           "35: SET_LOCAL 2\n"
+                           "37: POP\n"
+                           "38: LOOP 38 -> 18\n"
+                           "41: POP\n"
+                           "42: POP\n"
+                           "43: GET_LOCAL 2\n"
+                           "45: RETURN\n"
+                           "46: NIL\n"
+                           "47: RETURN\n";
+    EXPECT_EQ(bytecode, expected);
+}
+
+TEST(Superinstructions, ForInLoopFusesHeader) {
+    std::string bytecode = fusedFnBody(R"(
+        fun sum(xs) {
+            var total = 0;
+            for (var x in xs) total = total + x;
+            return total;
+        }
+    )");
+    // The whole eight-instruction header runs as one dispatch; the POP at
+    // the exit target discards the false it leaves when the loop ends.
+    std::string expected = "0: CONSTANT 0 ('0')\n"
+                           "3: GET_LOCAL 1\n"
+                           "5: GET_ITER\n"
+                           "6: NIL\n"
+                           "7: FOR_ITER 3 4 7 -> 31\n"
+                           "20: ADD_LOCALS 2 4\n"
+                           "25: SET_LOCAL 2\n"
+                           "27: POP\n"
+                           "28: LOOP 28 -> 7\n"
+                           "31: POP\n"
+                           "32: POP\n"
+                           "33: POP\n"
+                           "34: GET_LOCAL 2\n"
+                           "36: RETURN\n"
+                           "37: NIL\n"
+                           "38: RETURN\n";
+    EXPECT_EQ(bytecode, expected);
+}
+
+TEST(Superinstructions, CallBeforeReturnBecomesTailCall) {
+    std::string bytecode = fusedFnBody(R"(
+        fun walk(node, depth) {
+            if (node == nil) return depth;
+            if (node.leaf) return node.visit(depth);
+            return walk(node.next, depth + 1);
+        }
+    )");
+    // Only the head byte changes: the RETURN after each tail call stays in
+    // place for callees the VM does not run in the caller's frame.
+    std::string expected = "0: GET_LOCAL 1\n"
+                           "2: NIL\n"
+                           "3: EQUAL\n"
+                           "4: JUMP_IF_FALSE_POP 4 -> 14\n"
+                           "8: GET_LOCAL 2\n"
+                           "10: RETURN\n"
+                           "11: JUMP 11 -> 15\n"
+                           "14: POP\n"
+                           "15: GET_LOCAL 1\n"
+                           "17: GET_PROPERTY 0 ('leaf')\n"
+                           "20: JUMP_IF_FALSE_POP 20 -> 36\n"
+                           "24: GET_LOCAL 1\n"
+                           "26: GET_LOCAL 2\n"
+                           "28: TAIL_INVOKE 1 ('visit') 1\n"
+                           "32: RETURN\n"
+                           "33: JUMP 33 -> 37\n"
+                           "36: POP\n"
+                           "37: GET_GLOBAL 2 ('walk')\n"
+                           "40: GET_LOCAL 1\n"
+                           "42: GET_PROPERTY 3 ('next')\n"
+                           "45: GET_LOCAL 2\n"
+                           "47: CONSTANT 4 ('1')\n"
+                           "50: ADD\n"
+                           "51: TAIL_CALL 2\n"
+                           "53: RETURN\n"
+                           "54: NIL\n"
+                           "55: RETURN\n";
+    EXPECT_EQ(bytecode, expected);
+}
+
+TEST(Superinstructions, CallInsideExpressionIsNotTailCall) {
+    std::string bytecode = fusedFnBody(R"(
+        fun depth(node) {
+            if (node == nil) return 0;
+            return 1 + depth(node.next);
+        }
+    )");
+    EXPECT_EQ(bytecode.find("TAIL_"), std::string::npos) << bytecode;
+}
+
+TEST(Superinstructions, OffByDefault) {
+    // compile() without the flag is what the backends and the golden
+    // bytecode tests consume — it must stay canonical.
+    std::string bytecode = compile_fn_body_to_bytecode(
+        "fun f(a, b) { return a + b; }");
+    EXPECT_EQ(bytecode.find("ADD_LOCALS"), std::string::npos);
+    EXPECT_NE(bytecode.find("GET_LOCAL 1"), std::string::npos);
+}
+
+// ---------------------------------------------------------------------------
+// 2. Decoder sees the canonical stream
+// ---------------------------------------------------------------------------
+
+TEST(Superinstructions, DecoderCanonicalizesExampleCorpus) {
+    fs::path dir = fs::path(LOXPP_PROJECT_SOURCE_DIR) / "examples";
+    int checked = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() != ".lox")
+            continue;
+        std::ifstream in(entry.path(), std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+
+        MemoryManager plainMm;
+        MemoryManager fusedMm;
+        ObjFunction* plain = compile(ss.str(), &plainMm);
+        ObjFunction* fused =
+            compile(ss.str(), &fusedMm, /*superinstructions=*/true);
+        ASSERT_NE(plain, nullptr) << entry.path();
+        ASSERT_NE(fused, nullptr) << entry.path();
+        expectSameDecoding(decodeFunctionTree(plain),
+                           decodeFunctionTree(fused),
+                           entry.path().filename().string());
+        checked++;
+    }
+    EXPECT_GT(checked, 0);
+}
+
+// ---------------------------------------------------------------------------
+// 3. Execution, including guard misses
+// ---------------------------------------------------------------------------
+
+TEST(Superinstructions, NumericLoopsComputeSameResult) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun sum(n) {
+            var total = 0;
+            for (var i = 0; i < n; i = i + 1) total = total + i;
+            return total;
+        }
+        fun count() {
+            var i = 0;
+            while (i < 10) i = i + 1;
+            return i;
+        }
+        var s = sum(100);
+        var c = count();
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("s"), "4950");
+    EXPECT_EQ(h.getGlobalStr("c"), "10");
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST(Superinstructions, AddLocalsFallsBackForStrings) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun join(a, b) { return a + b; }
+        var r = join("foo", "bar");
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "foobar");
+}
+
+TEST(Superinstructions, IncrLocalFallsBackForStrings) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun build() {
+            var s = "a";
+            s = s + "b";
+            return s;
+        }
+        var r = build();
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "ab");
+}
+
+TEST(Superinstructions, LessLocalConstFallbackKeepsRuntimeError) {
+    VMTestHarness h;
+    EXPECT_EQ(h.run(R"(
+        fun f(s) {
+            if (s < 1) return 1;
+            return 2;
+        }
+        f("x");
+    )"),
+              InterpretResult::RUNTIME_ERROR);
+}
+
+TEST(Superinstructions, ConditionalJumpPopsOnBothPaths) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun pick(flag) {
+            var r = 0;
+            if (flag) r = 1; else r = 2;
+            return r;
+        }
+        var a = pick(true);
+        var b = pick(false);
+        var c = pick(nil) + pick("x");
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("a"), "1");
+    EXPECT_EQ(h.getGlobalStr("b"), "2");
+    EXPECT_EQ(h.getGlobalStr("c"), "3");
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST(Superinstructions, ForIterWalksEverySequenceType) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun walk(seq) {
+            var out = "";
+            for (var x in seq) {
+                if (x == "skip") continue;
+                if (x == "stop") break;
+                out = out + str(x);
+            }
+            return out;
+        }
+        var m = {"a": 1, "b": 2, "c": 3};
+        m.del("b");
+        var keys = 0;
+        for (var k in m) keys = keys + m[k];
+        var grow = [1, 2];
+        var seen = 0;
+        for (var g in grow) {
+            if (g < 4) grow.append(g + 2);
+            seen = seen + 1;
+        }
+        var r = walk([1, "skip", 2, "stop", 3]) + " " + walk("abc") + " " +
+                walk([]) + " " + str(keys) + " " + str(seen);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "12 abc  4 5");
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST(Superinstructions, NestedForInReusesFinishedIterators) {
+    // The inner loop's iterator goes back to the VM when it is exhausted and
+    // is handed out again by the next pass's GET_ITER; every pass must still
+    // start from the beginning of its own list, and a loop left by `break`
+    // must not give its (still live) iterator away.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        var rows = [[1, 2], [3], [], [4, 5, 6]];
+        var total = 0;
+        var firsts = 0;
+        for (var row in rows) {
+            for (var x in row) total = total * 10 + x;
+            for (var y in row) {
+                firsts = firsts + y;
+                break;
+            }
+        }
+        var r = str(total) + " " + str(firsts);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "123456 8");
+}
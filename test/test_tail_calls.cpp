@@ -0,0 +1,167 @@
+// test_tail_calls.cpp — TAIL_CALL / TAIL_INVOKE in the VM.
+//
+// The peephole pass marks a CALL or INVOKE directly followed by RETURN. The
+// VM then runs a closure or bound-method callee in the caller's frame. These
+// tests check that:
+//   1. tail recursion deeper than the frame limit runs, for plain calls,
+//      mutual recursion, methods, bound methods and closure-valued fields;
+//   2. the reused frame's upvalues are closed before its slots are
+//      overwritten;
+//   3. every other callee (natives, classes, list methods) still runs as a
+//      plain call followed by the RETURN;
+//   4. runtime errors still unwind cleanly from a reused frame.
+
+#include "test_harness.h"
+#include "vm.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+// ---------------------------------------------------------------------------
+// 1. Frame reuse
+// ---------------------------------------------------------------------------
+
+TEST(TailCalls, SelfRecursionIsNotBoundedByFrames) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun count(n, acc) {
+            if (n == 0) return acc;
+            return count(n - 1, acc + 1);
+        }
+        var r = count(100000, 0);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "100000");
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST(TailCalls, MutualRecursion) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun isEven(n) { if (n == 0) return true; return isOdd(n - 1); }
+        fun isOdd(n) { if (n == 0) return false; return isEven(n - 1); }
+        var r = isEven(5001);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "false");
+}
+
+TEST(TailCalls, MethodInvoke) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Counter {
+            init() { this.n = 0; }
+            run(k) {
+                if (k == 0) return this.n;
+                this.n = this.n + 1;
+                return this.run(k - 1);
+            }
+        }
+        var r = Counter().run(5000);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "5000");
+}
+
+TEST(TailCalls, BoundMethodKeepsReceiver) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Box {
+            init(v) { this.v = v; }
+            get() { return this.v; }
+        }
+        fun call(f) { return f(); }
+        var r = call(Box(7).get);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "7");
+}
+
+TEST(TailCalls, ClosureFieldInvoke) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Holder {}
+        var holder = Holder();
+        fun step(n) { if (n == 0) return "done"; return holder.f(n - 1); }
+        holder.f = step;
+        var r = holder.f(5000);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "done");
+}
+
+// ---------------------------------------------------------------------------
+// 2. Upvalues of the replaced frame
+// ---------------------------------------------------------------------------
+
+TEST(TailCalls, ClosesUpvaluesBeforeSlidingArguments) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun apply(f, x) { return f(x); }
+        fun make(n) {
+            var base = n;
+            base = base * 10;
+            fun add(x) { return base + x; }
+            return apply(add, 1);
+        }
+        var r = make(4);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "41");
+}
+
+// ---------------------------------------------------------------------------
+// 3. Callees that are not reused
+// ---------------------------------------------------------------------------
+
+TEST(TailCalls, OtherCalleesReturnNormally) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        class Point { init(x) { this.x = x; } }
+        fun native() { return str(12); }
+        fun ctor() { return Point(3); }
+        fun pop(xs) { return xs.pop(); }
+        var a = native();
+        var b = ctor().x;
+        var c = pop([1, 2]);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("a"), "12");
+    EXPECT_EQ(h.getGlobalStr("b"), "3");
+    EXPECT_EQ(h.getGlobalStr("c"), "2");
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+// ---------------------------------------------------------------------------
+// 4. Errors
+// ---------------------------------------------------------------------------
+
+TEST(TailCalls, ArityErrorInTailCall) {
+    VMTestHarness h;
+    EXPECT_EQ(h.run(R"(
+        fun one(a) { return a; }
+        fun caller() { return one(1, 2); }
+        caller();
+    )"),
+              InterpretResult::RUNTIME_ERROR);
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST(TailCalls, StackTraceMarksElidedFrames) {
+    VMTestHarness h;
+    testing::internal::CaptureStderr();
+    InterpretResult result = h.run(R"(
+        fun down(n) {
+            if (n == 0) return nil.field;
+            return down(n - 1);
+        }
+        down(3);
+    )");
+    std::string trace = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(result, InterpretResult::RUNTIME_ERROR);
+    EXPECT_NE(trace.find("in down()\n[... 3 frame(s) elided by tail calls]\n"
+                         "[line 6] in script"),
+              std::string::npos)
+        << trace;
+}
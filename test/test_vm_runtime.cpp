@@ -10,11 +10,19 @@
 //   semantics).
 //   5. Globals canonical  — getGlobal() is the sole source of truth; no stale
 //   reads.
-
+//   6. Global slots       — names resolve to stable slots at compile time;
+//   late binding and its errors are unchanged.
+//   7. Stack growth       — the value stack and frame array grow on demand;
+//   open upvalues survive the move and the frame limit is a clean error.
+
+#include "compiler.h"
+#include "global_slots.h"
+#include "memory_manager.h"
 #include "test_harness.h"
 #include <gtest/gtest.h>
 #include <cmath>
 #include <optional>
+#include <string>
 
 // ===========================================================================
 // Helpers
@@ -125,6 +133,14 @@ TEST_F(DefinedBeforeUseTest, DefinedGlobal_IsPresent) {
     EXPECT_TRUE(h.getGlobal("x").has_value());
 }
 
+TEST_F(DefinedBeforeUseTest, FailedAssignment_LeavesGlobalUndefined) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("fun f() { ghost = 1; }"), InterpretResult::OK);
+    EXPECT_EQ(h.run("f();"), InterpretResult::RUNTIME_ERROR);
+    expect_global_absent(h, "ghost");
+    EXPECT_EQ(h.run("ghost;"), InterpretResult::RUNTIME_ERROR);
+}
+
 // ===========================================================================
 // Invariant 3: DEFINE_GLOBAL semantics
 // ===========================================================================
@@ -235,6 +251,54 @@ TEST_F(GetSetGlobalTest, GlobalUsedInArithmetic) {
     expect_global_num(h, "y", 21.0);
 }
 
+// ===========================================================================
+// Invariant 6: Global slots
+// ===========================================================================
+
+class GlobalSlotTest : public ::testing::Test {};
+
+TEST_F(GlobalSlotTest, LateBindingAcrossRuns) {
+    // `later` gets its slot when get() is compiled, and is defined by a later
+    // program on the same VM.
+    VMTestHarness h;
+    ASSERT_EQ(h.run("fun get() { return later; }"), InterpretResult::OK);
+    EXPECT_EQ(h.run("get();"), InterpretResult::RUNTIME_ERROR);
+    ASSERT_EQ(h.run("var later = 5;\nvar r = get();"), InterpretResult::OK);
+    expect_global_num(h, "r", 5.0);
+    ASSERT_EQ(h.run("later = 6;\nr = get();"), InterpretResult::OK);
+    expect_global_num(h, "r", 6.0);
+}
+
+TEST_F(GlobalSlotTest, ChunkRecordsOneSlotPerName) {
+    MemoryManager mm;
+    GlobalSlots globals(VmAllocator<Entry>{&mm});
+    ObjFunction* script = compile("var a = 1;\nvar b = a;\na = b;", &mm,
+                                  /*superinstructions=*/false, &globals);
+    ASSERT_NE(script, nullptr);
+    const Chunk& chunk = script->chunk;
+    int named = 0;
+    for (uint16_t i = 0; i < chunk.constants().size(); i++) {
+        Value c = chunk.getConstant(i);
+        if (!is<Obj*>(c) || !isObjType(as<Obj*>(c), ObjType::STRING))
+            continue;
+        ObjString* name = asObjString(as<Obj*>(c));
+        EXPECT_EQ(chunk.globalSlots()[i], *globals.resolve(name))
+            << name->chars.c_str();
+        named++;
+    }
+    EXPECT_EQ(named, 2);
+    Value unset;
+    EXPECT_FALSE(globals.get(mm.makeString("a"), unset)); // not yet run
+}
+
+TEST_F(GlobalSlotTest, RedefiningANativeReusesItsSlot) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var n = len([1, 2]);\nvar len = 7;\nvar m = len;"),
+              InterpretResult::OK);
+    expect_global_num(h, "n", 2.0);
+    expect_global_num(h, "m", 7.0);
+}
+
 // ===========================================================================
 // Compile errors
 // ===========================================================================
@@ -513,6 +577,138 @@ TEST_F(NativeTest, Str_WrongArity_TooMany_RuntimeError) {
     EXPECT_EQ(h.run("str(1, 2);"), InterpretResult::RUNTIME_ERROR);
 }
 
+TEST_F(NativeTest, Str_CachedAndUncachedNumbers) {
+    // 0 .. kSmallIntStrings-1 come from MemoryManager's cache; everything
+    // else (including -0) still goes through stringify().
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        var r = str(0) + "," + str(1023) + "," + str(1024) + "," +
+                str(-0) + "," + str(-5) + "," + str(2.5);
+    )"),
+              InterpretResult::OK);
+    EXPECT_EQ(h.getGlobalStr("r"), "0,1023,1024,-0,-5,2.5");
+}
+
+TEST_F(NativeTest, SmallStringCacheSurvivesCollection) {
+    MemoryManager mm;
+    ObjString* q = mm.charString('q');
+    ObjString* nul = mm.charString('\0');
+    ObjString* high = mm.charString('\xff');
+    ObjString* n = mm.smallIntString(42);
+    mm.collectGarbage(); // no other roots
+    EXPECT_EQ(mm.findString("q"), q);
+    EXPECT_EQ(mm.findString("42"), n);
+    EXPECT_EQ(mm.charString('q'), q);
+    EXPECT_EQ(mm.charString('\0'), nul);
+    EXPECT_EQ(mm.charString('\xff'), high);
+    EXPECT_EQ(mm.smallIntString(42), n);
+    EXPECT_EQ(nul->chars.size(), 1u);
+}
+
+// ---------------------------------------------------------------------------
+// Long concatenations (ropes) and StringBuilder
+// ---------------------------------------------------------------------------
+
+TEST_F(NativeTest, LongConcatenationIsRopeUntilRead) {
+    MemoryManager mm;
+    ObjString* a = mm.makeString(std::string(40, 'a'));
+    ObjString* b = mm.makeString(std::string(40, 'b'));
+    mm.pushTempRoot(a);
+    mm.pushTempRoot(b);
+    ObjString* shortCat = mm.concat(mm.charString('x'), mm.charString('y'));
+    EXPECT_FALSE(shortCat->isRope());
+    EXPECT_EQ(mm.findString("xy"), shortCat);
+
+    ObjString* rope = mm.concat(a, b);
+    mm.pushTempRoot(rope);
+    EXPECT_TRUE(rope->isRope());
+    EXPECT_FALSE(rope->interned);
+    EXPECT_EQ(rope->length, 80u);
+    EXPECT_EQ(mm.findString(std::string(40, 'a') + std::string(40, 'b')),
+              nullptr);
+    EXPECT_EQ(rope->hashCode(),
+              hashString(std::string(40, 'a') + std::string(40, 'b')));
+
+    mm.flatten(rope);
+    EXPECT_FALSE(rope->isRope());
+    EXPECT_EQ(std::string(rope->chars.data(), rope->chars.size()),
+              std::string(40, 'a') + std::string(40, 'b'));
+    mm.popTempRoot();
+    mm.popTempRoot();
+    mm.popTempRoot();
+}
+
+TEST_F(NativeTest, RopesBehaveLikeStrings) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        var s = "";
+        for (var i = 0; i < 100; i = i + 1) s = s + str(i % 10);
+        var t = "";
+        for (var i = 0; i < 10; i = i + 1) t = t + "0123456789";
+        var same = s == t;
+        var differ = s == t + "!";
+        var m = {};
+        m[s] = "hit";
+        var viaMap = m[t];
+        var n = len(s);
+        var ch = s[57];
+        var tail = s[95:100];
+        var found = "8901" in s;
+        var nines = 0;
+        for (var c in s) if (c == "9") nines = nines + 1;
+    )"),
+              InterpretResult::OK);
+    expect_global_bool(h, "same", true);
+    expect_global_bool(h, "differ", false);
+    expect_global_str(h, "viaMap", "hit");
+    expect_global_num(h, "n", 100);
+    expect_global_str(h, "ch", "7");
+    expect_global_str(h, "tail", "56789");
+    expect_global_bool(h, "found", true);
+    expect_global_num(h, "nines", 10);
+}
+
+TEST_F(NativeTest, DeepRopeFlattensIteratively) {
+    // A rope as deep as the number of appends: flattening and hashing walk
+    // it with an explicit stack rather than recursing.
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        var s = "";
+        for (var i = 0; i < 200000; i = i + 1) s = s + "x";
+        var last = s[199999];
+        var m = {};
+        m[s] = 1;
+    )"),
+              InterpretResult::OK);
+    expect_global_str(h, "last", "x");
+}
+
+TEST_F(NativeTest, StringBuilderAppendAndBuild) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        var sb = StringBuilder();
+        sb.append("n=").append(42).append(" ").append(nil);
+        sb.append([1, 2]);
+        var built = sb.build();
+        var interned = built == "n=42 nil[1, 2]";
+        var shown = str(sb);
+        var again = sb.append("!").build();
+    )"),
+              InterpretResult::OK);
+    expect_global_str(h, "built", "n=42 nil[1, 2]");
+    expect_global_bool(h, "interned", true);
+    expect_global_str(h, "shown", "<string builder>");
+    expect_global_str(h, "again", "n=42 nil[1, 2]!");
+}
+
+TEST_F(NativeTest, StringBuilderRejectsUnknownMethod) {
+    VMTestHarness h;
+    EXPECT_EQ(h.run("StringBuilder().reverse();"),
+              InterpretResult::RUNTIME_ERROR);
+    EXPECT_EQ(h.run("StringBuilder().append();"),
+              InterpretResult::RUNTIME_ERROR);
+}
+
 // ---------------------------------------------------------------------------
 // Behavioural: natives usable in expressions
 // ---------------------------------------------------------------------------
@@ -572,3 +768,152 @@ TEST_F(ModuloTest, ZeroDividend) {
     ASSERT_EQ(h.run("0 % 5;"), InterpretResult::OK);
     EXPECT_NEAR(as<Number>(h.lastResult()), 0.0, 1e-9);
 }
+
+// ===========================================================================
+// Small-integer tag (LOXPP_NAN_TAGGING only; the variant build keeps every
+// number a double, so the representation checks are skipped there)
+// ===========================================================================
+
+class SmallIntTest : public ::testing::Test {};
+
+TEST_F(SmallIntTest, IntegerArithmeticStaysInt) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var a = 3 + 4; var b = a * 6 - 2; var c = b / 2;"),
+              InterpretResult::OK);
+    expect_global_num(h, "c", 20.0);
+#ifdef LOXPP_NAN_TAGGING
+    EXPECT_TRUE(isInt(*h.getGlobal("a")));
+    EXPECT_TRUE(isInt(*h.getGlobal("b")));
+    EXPECT_TRUE(isInt(*h.getGlobal("c")));
+#endif
+}
+
+TEST_F(SmallIntTest, OverflowPromotesToDouble) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var up = 2147483647 + 1; var down = -2147483648 - 1;"
+                    "var sq = 46341 * 46341; var neg = -(-2147483648);"),
+              InterpretResult::OK);
+    expect_global_num(h, "up", 2147483648.0);
+    expect_global_num(h, "down", -2147483649.0);
+    expect_global_num(h, "sq", 2147488281.0);
+    expect_global_num(h, "neg", 2147483648.0);
+    EXPECT_FALSE(isInt(*h.getGlobal("up")));
+}
+
+TEST_F(SmallIntTest, NegativeZeroStaysDouble) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var m = 0 * -1; var d = 0 / -1; var r = -4 % 2;"
+                    "var n = -0;"),
+              InterpretResult::OK);
+    for (const char* name : {"m", "d", "r", "n"}) {
+        auto v = h.getGlobal(name);
+        ASSERT_TRUE(v.has_value());
+        EXPECT_FALSE(isInt(*v)) << name;
+        EXPECT_TRUE(std::signbit(as<Number>(*v))) << name;
+    }
+}
+
+TEST_F(SmallIntTest, InexactDivisionIsDouble) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var q = 7 / 2;"), InterpretResult::OK);
+    expect_global_num(h, "q", 3.5);
+}
+
+TEST_F(SmallIntTest, IntsAndDoublesCompareAndHashAlike) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var eq = 1 == 1.0; var half = 0.5 + 0.5;"
+                    "var m = {1: \"one\"}; var hit = m[half];"
+                    "m[2.0] = \"two\"; var two = m[2]; var n = len(m);"),
+              InterpretResult::OK);
+    expect_global_bool(h, "eq", true);
+    expect_global_str(h, "hit", "one");
+    expect_global_str(h, "two", "two");
+    expect_global_num(h, "n", 2.0);
+}
+
+TEST_F(SmallIntTest, IndexingAcceptsIntsAndIntegralDoubles) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var l = [10, 20, 30]; var a = l[1]; var b = l[2.0];"
+                    "l[0.0] = 5; var c = l[0]; var s = \"abc\"[2];"
+                    "var t = \"abcdef\"[1:4.0];"),
+              InterpretResult::OK);
+    expect_global_num(h, "a", 20.0);
+    expect_global_num(h, "b", 30.0);
+    expect_global_num(h, "c", 5.0);
+    expect_global_str(h, "s", "c");
+    expect_global_str(h, "t", "bcd");
+    EXPECT_EQ(h.run("[1, 2][0.5];"), InterpretResult::RUNTIME_ERROR);
+}
+
+TEST_F(SmallIntTest, StringifyIsUnchanged) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("var a = str(42); var b = str(1000000); var c = str(-7);"
+                    "var d = str(2147483647 + 1);"),
+              InterpretResult::OK);
+    expect_global_str(h, "a", "42");
+    expect_global_str(h, "b", "1e+06");
+    expect_global_str(h, "c", "-7");
+    expect_global_str(h, "d", "2.14748e+09");
+}
+
+// ===========================================================================
+// Stack growth
+// ===========================================================================
+
+class StackGrowthTest : public ::testing::Test {};
+
+TEST_F(StackGrowthTest, DeepRecursionGrowsFrames) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run("fun d(n) { if (n == 0) return 0; return 1 + d(n - 1); }"
+                    "var r = d(5000);"),
+              InterpretResult::OK);
+    expect_global_num(h, "r", 5000.0);
+    EXPECT_EQ(h.stackDepth(), 0);
+}
+
+TEST_F(StackGrowthTest, OpenUpvalueSurvivesRelocation) {
+    VMTestHarness h;
+    ASSERT_EQ(h.run(R"(
+        fun d(n) { if (n == 0) return 0; return 1 + d(n - 1); }
+        fun outer() {
+            var x = 1;
+            fun bump() { x = x + 1; }
+            bump();
+            var depth = d(3000);
+            bump();
+            return x + depth;
+        }
+        var r = outer();
+    )"),
+              InterpretResult::OK);
+    expect_global_num(h, "r", 3003.0);
+}
+
+TEST_F(StackGrowthTest, WideListLiteralInDeepFrame) {
+    std::string items;
+    for (int i = 0; i < 250; ++i) {
+        items += (i ? ", " : "") + std::to_string(i);
+    }
+    VMTestHarness h;
+    ASSERT_EQ(h.run("fun wide() { return [" + items + "]; }"
+                    "fun d(n) { if (n == 0) return len(wide());"
+                    " return 0 + d(n - 1); }"
+                    "var r = d(900);"),
+              InterpretResult::OK);
+    expect_global_num(h, "r", 250.0);
+}
+
+TEST_F(StackGrowthTest, MaxStackDepthIsARuntimeError) {
+    VMTestHarness h;
+    h.setMaxStackDepth(100);
+    testing::internal::CaptureStderr();
+    InterpretResult result =
+        h.run("fun d(n) { if (n == 0) return 0; return 1 + d(n - 1); }"
+              "d(200);");
+    std::string trace = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(result, InterpretResult::RUNTIME_ERROR);
+    EXPECT_NE(trace.find("Stack overflow."), std::string::npos) << trace;
+    EXPECT_EQ(h.stackDepth(), 0);
+    ASSERT_EQ(h.run("var r = d(90);"), InterpretResult::OK);
+    expect_global_num(h, "r", 90.0);
+}
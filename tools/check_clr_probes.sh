@@ -135,7 +135,7 @@ probes=(
 # neither side prints anything before the error.
 error_probes=(
     "notes/translation-probes/24_call_before_closure.lox"
-    # Native's own frame-count ceiling (src/vm.h FRAMES_MAX): a backend
+    # Native's own frame-count ceiling (src/vm.h kDefaultMaxFrames): a backend
     # whose calling convention recurses its own host call stack has no
     # such ceiling unless it builds one, and a wrong build here is a
     # silent success on stdout otherwise. Lives in clr-only/, not directly